@@ -0,0 +1,204 @@
+/*
+ * Benchmarks for SimpleEnroll. Run them with `./main --benchmark`, ideally from
+ * an optimized build:
+ *
+ *   g++ -std=c++20 -O2 main.cpp -o main
+ *
+ * `./main --benchmark-parse [megabytes]` compares the serial and parallel CSV
+ * parsers on a generated catalog (256 MB by default). Both parses are kept in
+ * memory to compare them, which takes about 2.5 GB per 256 MB of CSV.
+ *
+ * Files written by the benchmarks go to the system temporary directory.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Runs `f` once and prints the total time and the average time per operation,
+ * where `operations` is the number of operations `f` performs.
+ */
+template <typename Func>
+void time_func(const std::string& label, Func f, size_t operations) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  auto end = std::chrono::steady_clock::now();
+
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  std::cout << std::left << std::setw(48) << label << std::right << std::setw(10)
+            << ns / 1000000 << "ms" << std::setw(12) << std::fixed << std::setprecision(1)
+            << static_cast<double>(ns) / operations << "ns/op\n";
+}
+
+/**
+ * Returns `size` courses made by repeating courses.csv. Every copy after the
+ * first gets a " #<copy>" suffix so that titles stay unique.
+ */
+std::vector<Course> scaled_catalog(size_t size) {
+  std::vector<Course> catalog;
+  parse_csv("courses.csv", catalog);
+
+  std::vector<Course> courses;
+  courses.reserve(size);
+  for (size_t i = 0; courses.size() < size; ++i) {
+    Course course = catalog[i % catalog.size()];
+    if (i >= catalog.size()) course.title += " #" + std::to_string(i / catalog.size());
+    courses.push_back(course);
+  }
+  return courses;
+}
+
+/**
+ * Removes the offered courses the way write_courses_offered used to: copy each
+ * one into a list, then find and erase them from the vector one at a time.
+ */
+void remove_offered_one_by_one(std::vector<Course>& all_courses) {
+  std::vector<Course> courses_to_remove;
+  for (auto course : all_courses) {
+    if (course.quarter != "null") courses_to_remove.push_back(course);
+  }
+  for (auto course : courses_to_remove) {
+    delete_elem_from_vector(all_courses, course);
+  }
+}
+
+/**
+ * Writes `courses` the way the output files used to be written: an
+ * `std::ofstream` with five `<<` insertions per row, copying each course.
+ */
+void write_courses_with_ofstream(const std::string& path, const std::vector<Course>& courses) {
+  std::ofstream ofs(path);
+  ofs << "Title,Number of Units,Quarter" << "\n";
+  for (auto course : courses) {
+    ofs << course.title << "," << course.number_of_units << "," << course.quarter << "\n";
+  }
+}
+
+/** Returns the contents of a file. */
+std::string read_file(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+/**
+ * Exports a large catalog with `std::ofstream` and with write_courses (which
+ * uses CsvWriter) and prints the throughput of each.
+ */
+int benchmark_writers(size_t size) {
+  auto courses = scaled_catalog(size);
+  auto dir = std::filesystem::temp_directory_path();
+  auto ofstream_path = (dir / "cs106l_ofstream.csv").string();
+  auto writer_path = (dir / "cs106l_csv_writer.csv").string();
+  std::cout << "Export: " << size << " courses\n";
+
+  auto report = [](const std::string& path, std::chrono::nanoseconds elapsed) {
+    double megabytes = std::filesystem::file_size(path) / 1e6;
+    std::cout << std::left << std::setw(48) << "  throughput" << std::right << std::setw(10)
+              << megabytes / (elapsed.count() / 1e9) << "MB/s\n";
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  time_func("std::ofstream <<", [&] { write_courses_with_ofstream(ofstream_path, courses); },
+            size);
+  report(ofstream_path, std::chrono::steady_clock::now() - start);
+
+  start = std::chrono::steady_clock::now();
+  time_func("write_courses (CsvWriter)",
+            [&] { write_courses(writer_path, courses.begin(), courses.end()); }, size);
+  report(writer_path, std::chrono::steady_clock::now() - start);
+
+  bool same = read_file(ofstream_path) == read_file(writer_path);
+  std::filesystem::remove(ofstream_path);
+  std::filesystem::remove(writer_path);
+  if (!same) {
+    std::cerr << "CsvWriter wrote a different file than std::ofstream!\n";
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * Writes a catalog of at least `megabytes` MB to a temporary file, parses it
+ * with parse_csv and with parse_csv_parallel on 1, 2, 4 and (if more) all
+ * hardware threads, and checks that every parse gives the same courses. Some
+ * titles are quoted and contain commas, quotes and newlines.
+ */
+int run_parse_benchmark(size_t megabytes) {
+  auto path = (std::filesystem::temp_directory_path() / "cs106l_parse.csv").string();
+  size_t records = 0;
+  {
+    std::vector<Course> catalog;
+    parse_csv("courses.csv", catalog);
+    CsvWriter writer(path);
+    writer.write_row("Title", "Number of Units", "Quarter");
+    size_t bytes = 0;
+    for (size_t i = 0; bytes < megabytes << 20; ++i, ++records) {
+      Course course = catalog[i % catalog.size()];
+      course.title += " #" + std::to_string(i / catalog.size());
+      if (i % 10 == 0) course.title += ", Part \"A\"";
+      if (i % 1000 == 0) course.title += "\n(continued)";
+      writer.write_row(course.title, course.number_of_units, course.quarter);
+      bytes += course.title.size() + course.number_of_units.size() + course.quarter.size() + 3;
+    }
+  }
+  size_t bytes = std::filesystem::file_size(path);
+  std::cout << "Catalog: " << records << " courses, " << (bytes >> 20) << " MB\n";
+
+  std::vector<Course> serial;
+  time_func("parse_csv", [&] { parse_csv(path, serial); }, records);
+
+  std::vector<size_t> thread_counts = {1, 2, 4};
+  if (std::thread::hardware_concurrency() > 4) {
+    thread_counts.push_back(std::thread::hardware_concurrency());
+  }
+  for (size_t threads : thread_counts) {
+    std::vector<Course> parallel;
+    time_func("parse_csv_parallel (" + std::to_string(threads) + " threads)",
+              [&] { parse_csv_parallel(path, parallel, threads); }, records);
+    if (parallel != serial || serial.size() != records) {
+      std::cerr << "parse_csv_parallel gave different courses than parse_csv!\n";
+      std::filesystem::remove(path);
+      return 1;
+    }
+  }
+  std::filesystem::remove(path);
+  return 0;
+}
+
+/**
+ * Removes the offered courses from catalogs of increasing size, erasing them
+ * one by one (quadratic) and with partition_offered (linear). The quadratic
+ * version is only run on the smaller catalogs. Then times exporting courses.
+ */
+int run_benchmarks() {
+  for (size_t size : {10000, 20000, 40000, 1000000}) {
+    auto courses = scaled_catalog(size);
+    std::cout << "Catalog: " << size << " courses\n";
+
+    std::vector<Course> one_by_one;
+    if (size <= 40000) {
+      one_by_one = courses;
+      time_func("find + erase each offered course",
+                [&] { remove_offered_one_by_one(one_by_one); }, size);
+    }
+
+    std::vector<Course> partitioned = courses;
+    time_func("partition_offered + erase",
+              [&] { partitioned.erase(partition_offered(partitioned), partitioned.end()); },
+              size);
+
+    if (size <= 40000 && partitioned != one_by_one) {
+      std::cerr << "partition_offered kept the wrong courses!\n";
+      return 1;
+    }
+  }
+  return benchmark_writers(5000000);
+}
@@ -0,0 +1,301 @@
+/*
+ * CS106L CSV reader
+ *
+ * A zero-copy reader for comma-separated files. The file is memory-mapped and
+ * every field is returned as a `std::string_view` into the mapping, so reading
+ * a record allocates nothing. This header is shared by assignments 1 and 6;
+ * keep the copies identical.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * A read-only view of a whole file. On POSIX systems the file is mapped into
+ * memory with `mmap`; elsewhere it is read into a buffer.
+ */
+class MappedFile
+{
+public:
+  explicit MappedFile(const std::string& filename)
+  {
+#ifdef _WIN32
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+      return;
+    buffer.assign(std::istreambuf_iterator<char>(file),
+                  std::istreambuf_iterator<char>());
+    contents = buffer;
+    open = true;
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+      return;
+
+    struct stat info;
+    if (::fstat(fd, &info) == 0) {
+      open = true;
+      size_t size = static_cast<size_t>(info.st_size);
+      if (size > 0) {
+        void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+          ::madvise(data, size, MADV_SEQUENTIAL);
+          contents = { static_cast<const char*>(data), size };
+          mapped = true;
+        } else {
+          open = false;
+        }
+      }
+    }
+    ::close(fd);
+#endif
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& other) noexcept
+    : buffer(std::move(other.buffer))
+    , contents(std::exchange(other.contents, {}))
+    , open(std::exchange(other.open, false))
+    , mapped(std::exchange(other.mapped, false))
+  {
+    if (!mapped && open)
+      contents = buffer;
+  }
+
+  MappedFile& operator=(MappedFile&& other) noexcept
+  {
+    if (this != &other) {
+      unmap();
+      buffer = std::move(other.buffer);
+      contents = std::exchange(other.contents, {});
+      open = std::exchange(other.open, false);
+      mapped = std::exchange(other.mapped, false);
+      if (!mapped && open)
+        contents = buffer;
+    }
+    return *this;
+  }
+
+  ~MappedFile() { unmap(); }
+
+  /** Whether the file could be opened. An empty file is open but has no text. */
+  bool is_open() const { return open; }
+
+  /** The contents of the file, valid for as long as this object is. */
+  std::string_view text() const { return contents; }
+
+private:
+  void unmap()
+  {
+#ifndef _WIN32
+    if (mapped)
+      ::munmap(const_cast<char*>(contents.data()), contents.size());
+#endif
+    mapped = false;
+  }
+
+  std::string buffer;
+  std::string_view contents;
+  bool open = false;
+  bool mapped = false;
+};
+
+/**
+ * Splits CSV text into records and fields without copying it.
+ *
+ * Records end at "\n" or "\r\n"; blank lines are skipped. A field may be
+ * wrapped in double quotes, in which case it can contain the delimiter and
+ * newlines, and a literal quote is written as two quotes (""). Quoted fields
+ * are returned without their surrounding quotes but with any doubled quotes
+ * left in place; pass them through `csv_unescape` to get the final text.
+ */
+class CsvReader
+{
+public:
+  explicit CsvReader(std::string_view text, char delim = ',')
+    : pos(text.data())
+    , end(text.data() + text.size())
+    , delim(delim)
+  {
+  }
+
+  /**
+   * Reads the next record into `fields`, replacing its contents. Reusing the
+   * same vector for every record means no allocation once it has grown to the
+   * widest record.
+   * @return false (leaving `fields` empty) once there are no records left.
+   */
+  bool next(std::vector<std::string_view>& fields)
+  {
+    fields.clear();
+    while (pos != end && (*pos == '\n' || *pos == '\r'))
+      ++pos;
+    if (pos == end)
+      return false;
+
+    while (true) {
+      const char* stop;
+      if (*pos == '"') {
+        const char* close = find_closing_quote(pos + 1);
+        fields.emplace_back(pos + 1, close - (pos + 1));
+        // Anything between the closing quote and the delimiter is dropped
+        stop = find_any(close == end ? end : close + 1, delim, '\n', '\r');
+      } else {
+        stop = find_any(pos, delim, '\n', '\r');
+        fields.emplace_back(pos, stop - pos);
+      }
+
+      if (stop == end) {
+        pos = end;
+        return true;
+      }
+      if (*stop == delim) {
+        pos = stop + 1;
+        if (pos == end) {
+          fields.emplace_back();
+          return true;
+        }
+        continue;
+      }
+      pos = stop + (*stop == '\r' && stop + 1 != end && stop[1] == '\n' ? 2 : 1);
+      return true;
+    }
+  }
+
+private:
+  /** Returns the first character in [from, end) equal to a, b or c, or end. */
+  const char* find_any(const char* from, char a, char b, char c) const
+  {
+#if defined(__SSE2__)
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    const __m128i vc = _mm_set1_epi8(c);
+    while (end - from >= 16) {
+      __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from));
+      __m128i hits = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb)),
+        _mm_cmpeq_epi8(chunk, vc));
+      int mask = _mm_movemask_epi8(hits);
+      if (mask != 0)
+        return from + __builtin_ctz(static_cast<unsigned>(mask));
+      from += 16;
+    }
+#endif
+    while (from != end && *from != a && *from != b && *from != c)
+      ++from;
+    return from;
+  }
+
+  /**
+   * Returns the quote that closes a quoted field whose text starts at `from`,
+   * skipping doubled quotes, or end if the field is never closed.
+   */
+  const char* find_closing_quote(const char* from) const
+  {
+    while (true) {
+      const char* quote = find_any(from, '"', '"', '"');
+      if (quote == end || quote + 1 == end || quote[1] != '"')
+        return quote;
+      from = quote + 2;
+    }
+  }
+
+  const char* pos;
+  const char* end;
+  char delim;
+};
+
+/**
+ * Splits CSV text into at most `parts` pieces of roughly equal size that each
+ * hold whole records, so that each piece can be read by its own `CsvReader`
+ * (for example on its own thread). Pieces only end at newlines that are not
+ * inside a quoted field. Reading the pieces in order gives the same records as
+ * reading `text` in one go.
+ */
+inline std::vector<std::string_view>
+split_csv_chunks(std::string_view text, size_t parts, char delim = ',')
+{
+  // Tracks whether a position is inside a quoted field by walking the quotes
+  // before it. Like CsvReader, a quote only opens a field at the start of the
+  // field, or right after a closing quote (a doubled quote).
+  bool quoted = false;
+  size_t last_close = std::string_view::npos;
+  size_t next_quote = text.find('"');
+  auto walk_quotes_before = [&](size_t pos) {
+    for (; next_quote < pos; next_quote = text.find('"', next_quote + 1)) {
+      size_t q = next_quote;
+      if (quoted) {
+        quoted = false;
+        last_close = q;
+      } else if (q == 0 || text[q - 1] == delim || text[q - 1] == '\n' ||
+                 text[q - 1] == '\r' || q == last_close + 1) {
+        quoted = true;
+      }
+    }
+  };
+
+  std::vector<std::string_view> chunks;
+  size_t start = 0;
+  for (size_t part = 1; part < parts && start < text.size(); ++part) {
+    size_t end = text.size();
+    size_t pos = std::max(start, text.size() / parts * part);
+    while (pos < text.size()) {
+      size_t newline = text.find('\n', pos);
+      if (newline == std::string_view::npos)
+        break;
+      walk_quotes_before(newline);
+      if (!quoted) {
+        end = newline + 1;
+        break;
+      }
+      pos = newline + 1;
+    }
+
+    chunks.push_back(text.substr(start, end - start));
+    start = end;
+  }
+  if (start < text.size() || chunks.empty())
+    chunks.push_back(text.substr(start));
+  return chunks;
+}
+
+/**
+ * Returns the text of a field read by `CsvReader`, turning each doubled quote
+ * ("") back into a single quote.
+ */
+inline std::string
+csv_unescape(std::string_view field)
+{
+  if (field.find('"') == std::string_view::npos)
+    return std::string(field);
+
+  std::string text;
+  text.reserve(field.size());
+  for (size_t i = 0; i < field.size(); ++i) {
+    text.push_back(field[i]);
+    if (field[i] == '"' && i + 1 < field.size() && field[i + 1] == '"')
+      ++i;
+  }
+  return text;
+}
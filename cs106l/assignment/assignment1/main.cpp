@@ -14,8 +14,12 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "csv_reader.h"
+#include "csv_writer.h"
+
 const std::string COURSES_OFFERED_PATH = "student_output/courses_offered.csv";
 const std::string COURSES_NOT_OFFERED_PATH = "student_output/courses_not_offered.csv";
 
@@ -45,6 +49,26 @@ struct Course {
  */
 #include "utils.cpp"
 
+/**
+ * Appends a `Course` to `courses` for each record in `text`, which holds whole
+ * CSV records.
+ *
+ * @param text        The CSV records to parse.
+ * @param courses     A vector of courses to populate.
+ * @param skip_header Whether the first record is the column name line.
+ */
+void parse_records(std::string_view text, std::vector<Course>& courses, bool skip_header) {
+  CsvReader reader(text);
+  std::vector<std::string_view> fields;
+  if (skip_header) reader.next(fields);
+
+  while (reader.next(fields)) {
+    fields.resize(3);
+    courses.push_back(Course{csv_unescape(fields[0]), csv_unescape(fields[1]),
+                             csv_unescape(fields[2])});
+  }
+}
+
 /**
  * This function should populate the `courses` vector with structs of type
  * `Course`. We want to create these structs with the records in the courses.csv
@@ -59,17 +83,77 @@ struct Course {
  * @param courses  A vector of courses to populate.
  */
 void parse_csv(std::string filename, std::vector<Course>& courses) {
-  std::ifstream ifs(filename);
-  if (ifs.is_open()) {
-    std::string line;
-    std::getline(ifs, line);  // remove column name line
-
-    while (std::getline(ifs, line)) {
-      char delim = ',';
-      std::vector<std::string> course_vec = split(line, delim);
-      
-      Course course {course_vec[0], course_vec[1], course_vec[2]};
-      courses.push_back(course);
+  MappedFile file(filename);
+  if (file.is_open()) {
+    parse_records(file.text(), courses, true);
+  }
+}
+
+/**
+ * Does the same as `parse_csv`, but splits the file into `num_threads` pieces
+ * that end on record boundaries and parses each piece on its own thread. The
+ * courses end up in the same order as `parse_csv` would put them in.
+ *
+ * @param filename    The name of the file to parse.
+ * @param courses     A vector of courses to populate.
+ * @param num_threads The number of threads to parse with.
+ */
+void parse_csv_parallel(std::string filename, std::vector<Course>& courses,
+                        size_t num_threads = std::thread::hardware_concurrency()) {
+  MappedFile file(filename);
+  if (!file.is_open()) return;
+
+  auto chunks = split_csv_chunks(file.text(), std::max<size_t>(num_threads, 1));
+  if (chunks.size() == 1) {
+    parse_records(chunks[0], courses, true);
+    return;
+  }
+
+  std::vector<std::vector<Course>> parsed(chunks.size());
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < chunks.size(); ++i) {
+    workers.emplace_back([&, i] { parse_records(chunks[i], parsed[i], false); });
+  }
+  parse_records(chunks[0], parsed[0], true);
+  for (auto& worker : workers) worker.join();
+
+  size_t total = courses.size();
+  for (const auto& chunk : parsed) total += chunk.size();
+  courses.reserve(total);
+  for (auto& chunk : parsed) {
+    std::move(chunk.begin(), chunk.end(), std::back_inserter(courses));
+    chunk = std::vector<Course>();
+  }
+}
+
+/**
+ * Moves the courses that are offered to the end of `courses`, keeping the
+ * courses in each group in their original order. Runs in one linear pass and
+ * moves courses rather than copying them.
+ *
+ * @param courses The courses to partition.
+ * @returns       An iterator to the first offered course.
+ */
+std::vector<Course>::iterator partition_offered(std::vector<Course>& courses) {
+  return std::stable_partition(courses.begin(), courses.end(), [](const Course& course) {
+    return course.quarter == "null";
+  });
+}
+
+/**
+ * Writes the CSV column headers, then one row for each course in [first, last).
+ *
+ * @param path  The file to write.
+ * @param first The first course to write.
+ * @param last  One past the last course to write.
+ */
+void write_courses(const std::string& path, std::vector<Course>::const_iterator first,
+                   std::vector<Course>::const_iterator last) {
+  CsvWriter writer(path);
+  if (writer.is_open()) {
+    writer.write_row("Title", "Number of Units", "Quarter");
+    for (; first != last; ++first) {
+      writer.write_row(first->title, first->number_of_units, first->quarter);
     }
   }
 }
@@ -83,32 +167,16 @@ void parse_csv(std::string filename, std::vector<Course>& courses) {
  * 2) Delete the courses that are offered from the `all_courses` vector.
  * IMPORTANT: do this after you write out to the file!
  *
- * HINTS:
- * 1) Keep track of the classes that you need to delete!
- * 2) Use the delete_elem_from_vector function we give you!
- * 3) Remember to write the CSV column headers at the beginning of the output!
- *    See courses.csv for reference.
+ * The offered courses are partitioned to the end of the vector, written from
+ * there, and then erased in one step, so this runs in linear time.
  *
  * @param all_courses A vector of all courses gotten by calling `parse_csv`.
  *                    This vector will be modified by removing all offered courses.
  */
 void write_courses_offered(std::vector<Course>& all_courses) {
-  std::vector<Course> courses_to_remove;
-  for (auto course : all_courses) {
-    if (course.quarter != "null") courses_to_remove.push_back(course);
-  }
-  
-  std::ofstream ofs(COURSES_OFFERED_PATH);
-  if (ofs.is_open()) {
-    ofs << "Title,Number of Units,Quarter" << "\n";
-    for (auto course : courses_to_remove) {
-      ofs << course.title << "," << course.number_of_units << "," << course.quarter << "\n";
-    }
-  }
-
-  for (auto course : courses_to_remove) {
-    delete_elem_from_vector(all_courses, course);
-  }
+  auto offered = partition_offered(all_courses);
+  write_courses(COURSES_OFFERED_PATH, offered, all_courses.end());
+  all_courses.erase(offered, all_courses.end());
 }
 
 /**
@@ -120,24 +188,23 @@ void write_courses_offered(std::vector<Course>& all_courses) {
  * since you delete offered classes from `all_courses` in the
  * `write_courses_offered` function.
  *
- * HINT: This should be VERY similar to `write_courses_offered`
- *
  * @param unlisted_courses A vector of courses that are not offered.
  */
-void write_courses_not_offered(std::vector<Course> unlisted_courses) {
-  std::ofstream ofs(COURSES_NOT_OFFERED_PATH);
-  if (ofs.is_open()) {
-    ofs << "Title,Number of Units,Quarter" << "\n";
-    for (auto course : unlisted_courses) {
-      ofs << course.title << "," << course.number_of_units << "," << course.quarter << "\n";
-    }
-  }
+void write_courses_not_offered(const std::vector<Course>& unlisted_courses) {
+  write_courses(COURSES_NOT_OFFERED_PATH, unlisted_courses.begin(), unlisted_courses.end());
 }
 
-int main() {
+#include "autograder/benchmarks.hpp"
+
+int main(int argc, char* argv[]) {
   /* Makes sure you defined your Course struct correctly! */
   static_assert(is_valid_course<Course>, "Course struct is not correctly defined!");
 
+  if (argc == 2 && std::string_view(argv[1]) == "--benchmark") return run_benchmarks();
+  if (argc >= 2 && argc <= 3 && std::string_view(argv[1]) == "--benchmark-parse") {
+    return run_parse_benchmark(argc == 3 ? std::stoul(argv[2]) : 256);
+  }
+
   std::vector<Course> courses;
   parse_csv("courses.csv", courses);
 
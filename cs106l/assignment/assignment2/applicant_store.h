@@ -0,0 +1,235 @@
+/*
+ * CS106L Assignment 2: Marriage Pact
+ *
+ * A compact, sorted set of applicant names.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * The distinct names in an applicant file, in sorted order, like the
+ * `std::set<std::string>` that `get_applicants` returns but far smaller.
+ *
+ * Every name is stored once, end to end, in a single string (the arena), and
+ * located through an array of offsets, so each applicant costs its characters
+ * plus four bytes instead of a tree node and a heap-allocated string. A name is
+ * referred to by its ID, which is its position in sorted order. IDs, and the
+ * `std::string_view`s the store hands out, stay valid as long as the store does.
+ */
+class ApplicantStore
+{
+public:
+  using Id = uint32_t;
+
+  ApplicantStore() = default;
+
+  /**
+   * Reads the file in one go and keeps each distinct non-empty line. Lines may
+   * end in "\n" or "\r\n". The lines are radix sorted by their first sixteen
+   * bytes, so loading takes far fewer string comparisons than building a set.
+   * @throws std::runtime_error if the file cannot be read.
+   */
+  explicit ApplicantStore(const std::string& filename)
+  {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+      throw std::runtime_error("ApplicantStore: could not open " + filename);
+    std::string text(static_cast<size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    file.read(text.data(), static_cast<std::streamsize>(text.size()));
+
+    std::vector<Line> lines;
+    lines.reserve(std::count(text.begin(), text.end(), '\n') + 1);
+    for (std::string_view rest = text; !rest.empty();) {
+      size_t end = std::min(rest.find('\n'), rest.size());
+      std::string_view name = rest.substr(0, end);
+      rest.remove_prefix(std::min(end + 1, rest.size()));
+      if (!name.empty() && name.back() == '\r')
+        name.remove_suffix(1);
+      if (!name.empty())
+        lines.push_back(Line::from(name));
+    }
+    {
+      std::vector<Line> scratch(lines.size());
+      radix_sort(lines, scratch, 0);
+    }
+
+    // Names of up to sixteen bytes are entirely in their keys
+    auto same_name = [](const Line& a, const Line& b) {
+      return a.high == b.high && a.low == b.low &&
+             a.name.size() == b.name.size() &&
+             (a.name.size() <= 16 || a.name == b.name);
+    };
+    size_t bytes = 0;
+    for (size_t i = 0; i < lines.size(); ++i) {
+      if (i == 0 || !same_name(lines[i], lines[i - 1]))
+        bytes += lines[i].name.size();
+    }
+    if (bytes > UINT32_MAX)
+      throw std::length_error("ApplicantStore: names exceed 4 GB");
+
+    arena.resize(bytes);
+    offsets.reserve(lines.size() + 1);
+    offsets.push_back(0);
+    char* out = arena.data();
+    for (size_t i = 0; i < lines.size(); ++i) {
+      const Line& line = lines[i];
+      if (i > 0 && same_name(line, lines[i - 1]))
+        continue;
+      if (line.name.size() <= 16) {
+        uint64_t key[2] = { to_big_endian(line.high), to_big_endian(line.low) };
+        std::memcpy(out, key, line.name.size());
+      } else {
+        std::memcpy(out, line.name.data(), line.name.size());
+      }
+      out += line.name.size();
+      offsets.push_back(static_cast<uint32_t>(out - arena.data()));
+    }
+    offsets.shrink_to_fit();
+  }
+
+  /** The number of distinct applicants. */
+  size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+
+  /** The name of the applicant with the given ID. */
+  std::string_view operator[](Id id) const
+  {
+    return std::string_view(arena).substr(offsets[id],
+                                          offsets[id + 1] - offsets[id]);
+  }
+
+  /** The ID of the applicant with the given name, if there is one. */
+  std::optional<Id> find(std::string_view name) const
+  {
+    auto ids = std::views::iota(Id{ 0 }, static_cast<Id>(size()));
+    auto it = std::ranges::lower_bound(
+      ids, name, {}, [this](Id id) { return (*this)[id]; });
+    if (it == ids.end() || (*this)[*it] != name)
+      return std::nullopt;
+    return *it;
+  }
+
+  /** Every name, in sorted order, as a range of `std::string_view`. */
+  auto names() const
+  {
+    return std::views::iota(Id{ 0 }, static_cast<Id>(size())) |
+           std::views::transform([this](Id id) { return (*this)[id]; });
+  }
+
+  /** The bytes of memory the store holds on to. */
+  size_t memory_usage() const
+  {
+    return arena.capacity() + offsets.capacity() * sizeof(uint32_t);
+  }
+
+private:
+  /**
+   * A name being loaded, keyed by its first sixteen bytes so that sorting
+   * rarely has to look at the text.
+   */
+  struct Line
+  {
+    uint64_t high, low;
+    std::string_view name;
+
+    static Line from(std::string_view name)
+    {
+      return { big_endian_prefix(name),
+               big_endian_prefix(name.substr(std::min<size_t>(8, name.size()))),
+               name };
+    }
+
+    /** The byte of the key at `position`, from 0 to 15. */
+    unsigned char byte(size_t position) const
+    {
+      uint64_t half = position < 8 ? high : low;
+      return static_cast<unsigned char>(half >> (56 - 8 * (position % 8)));
+    }
+
+    bool operator<(const Line& other) const
+    {
+      if (high != other.high)
+        return high < other.high;
+      if (low != other.low)
+        return low < other.low;
+      return name < other.name;
+    }
+  };
+
+  /**
+   * Sorts `lines`, whose keys all agree before byte `position`, using
+   * `scratch` (of the same size) as temporary space. Sorts by one key byte at
+   * a time from the front (an MSD radix sort), and switches to `std::sort` for
+   * small groups and once the key runs out.
+   */
+  static void radix_sort(std::span<Line> lines,
+                         std::span<Line> scratch,
+                         size_t position)
+  {
+    std::array<size_t, 257> starts;
+    // Bytes that every line shares, such as a common first name, need no pass
+    for (;; ++position) {
+      if (position == 16 || lines.size() <= 64) {
+        std::sort(lines.begin(), lines.end());
+        return;
+      }
+      starts.fill(0);
+      for (const Line& line : lines)
+        ++starts[line.byte(position) + 1];
+      if (starts[lines[0].byte(position) + 1] != lines.size())
+        break;
+    }
+
+    for (size_t b = 1; b <= 256; ++b)
+      starts[b] += starts[b - 1];
+    std::array<size_t, 256> next;
+    std::copy(starts.begin(), starts.end() - 1, next.begin());
+    for (const Line& line : lines)
+      scratch[next[line.byte(position)]++] = line;
+    std::copy(scratch.begin(), scratch.end(), lines.begin());
+
+    for (size_t b = 0; b < 256; ++b) {
+      if (size_t count = starts[b + 1] - starts[b]; count > 1) {
+        radix_sort(lines.subspan(starts[b], count),
+                   scratch.subspan(starts[b], count),
+                   position + 1);
+      }
+    }
+  }
+
+  /** The first eight bytes of `name`, zero-padded, as a big-endian integer. */
+  static uint64_t big_endian_prefix(std::string_view name)
+  {
+    uint64_t prefix = 0;
+    std::memcpy(&prefix, name.data(), std::min<size_t>(name.size(), 8));
+    return to_big_endian(prefix);
+  }
+
+  /** Reverses the bytes of `x` on little-endian machines. */
+  static uint64_t to_big_endian(uint64_t x)
+  {
+    if constexpr (std::endian::native == std::endian::big)
+      return x;
+    uint64_t reversed = 0;
+    for (size_t i = 0; i < 8; ++i, x >>= 8)
+      reversed = reversed << 8 | (x & 0xff);
+    return reversed;
+  }
+
+  std::string arena;
+  std::vector<uint32_t> offsets;
+};
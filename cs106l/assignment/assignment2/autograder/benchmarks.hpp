@@ -0,0 +1,332 @@
+/*
+ * Benchmarks for the Marriage Pact. Run them with `./main --benchmark [lines]`,
+ * ideally from an optimized build:
+ *
+ *   g++ -std=c++20 -O2 main.cpp -o main
+ *
+ * The benchmarks generate an applicant file with `lines` names (10 million by
+ * default) in the system temporary directory. `./main --benchmark-match [lines]`
+ * times matching every applicant at once (1 million by default).
+ * `./main --check-index` checks the InitialsIndex version of `find_matches`
+ * against the set version, and an index of `ApplicantStore` IDs against one of
+ * pointers, on students.txt.
+ */
+
+#pragma once
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <queue>
+#include <ranges>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * Runs `f` once and prints the total time and the average time per operation,
+ * where `operations` is the number of operations `f` performs.
+ */
+template<typename Func>
+void
+time_func(const std::string& label, Func f, size_t operations)
+{
+  auto start = std::chrono::steady_clock::now();
+  f();
+  auto end = std::chrono::steady_clock::now();
+
+  auto ns =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  std::cout << std::left << std::setw(48) << label << std::right
+            << std::setw(10) << ns / 1000000 << "ms" << std::setw(16)
+            << std::fixed << std::setprecision(1)
+            << static_cast<double>(ns) / operations << "ns/op\n";
+}
+
+/**
+ * Writes `lines` distinct "First Last" names to `path`, combining the first and
+ * last names in students.txt. Last names get a number once every combination
+ * has been used, which keeps their initials.
+ */
+void
+write_applicant_file(const std::filesystem::path& path, size_t lines)
+{
+  std::vector<std::string> firsts, lasts;
+  {
+    std::ifstream students("students.txt");
+    std::string first, last;
+    while (students >> first >> last) {
+      firsts.push_back(first);
+      lasts.push_back(last);
+    }
+  }
+  if (firsts.empty()) {
+    std::cerr << "Run the benchmarks from the assignment2 directory.\n";
+    std::exit(1);
+  }
+  // Names repeat in students.txt, and repeated combinations would be dropped
+  for (auto* parts : { &firsts, &lasts }) {
+    std::sort(parts->begin(), parts->end());
+    parts->erase(std::unique(parts->begin(), parts->end()), parts->end());
+  }
+
+  std::ofstream out(path, std::ios::binary);
+  std::string name;
+  for (size_t i = 0; i < lines; ++i) {
+    size_t combination = i % (firsts.size() * lasts.size());
+    name = firsts[combination % firsts.size()];
+    name += ' ';
+    name += lasts[combination / firsts.size()];
+    if (size_t round = i / (firsts.size() * lasts.size()); round > 0)
+      name += std::to_string(round);
+    name += '\n';
+    out << name;
+  }
+}
+
+/**
+ * Returns the bytes currently allocated by malloc (including large blocks that
+ * get their own mapping), or 0 where that is not known.
+ */
+size_t
+heap_in_use()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+  auto info = mallinfo2();
+  return info.uordblks + info.hblkhd;
+#else
+  return 0;
+#endif
+}
+
+/** Prints how much memory a container of applicants took, if it is known. */
+void
+print_memory(size_t bytes, size_t applicants)
+{
+  if (bytes == 0)
+    return;
+  std::cout << "  " << bytes / 1000000 << " MB, " << std::setprecision(1)
+            << static_cast<double>(bytes) / applicants << " bytes per applicant\n";
+}
+
+/**
+ * Indexes the applicants in `store` by their IDs, which take half the memory
+ * of pointers and stay valid if the store is moved.
+ */
+InitialsIndex<ApplicantStore::Id>
+index_ids(const ApplicantStore& store)
+{
+  return InitialsIndex<ApplicantStore::Id>(
+    store.names(), [](std::string_view, size_t position) {
+      return static_cast<ApplicantStore::Id>(position);
+    });
+}
+
+/**
+ * Returns whether `ids` (into `store`) and `pointers` refer to the same names,
+ * in the same order.
+ */
+bool
+same_names(std::span<const ApplicantStore::Id> ids,
+           std::span<const std::string* const> pointers,
+           const ApplicantStore& store)
+{
+  return std::ranges::equal(
+    ids, pointers, {}, [&](ApplicantStore::Id id) { return store[id]; },
+    [](const std::string* name) { return std::string_view(*name); });
+}
+
+/**
+ * Loads a generated applicant file into a `std::set` and an `ApplicantStore`,
+ * comparing time and memory. Then looks up the matches of many
+ * applicants with the InitialsIndex and of a few by walking the whole set.
+ */
+int
+run_benchmarks(size_t lines)
+{
+  auto path = std::filesystem::temp_directory_path() / "cs106l_applicants.txt";
+  write_applicant_file(path, lines);
+  std::cout << "Applicants: " << lines << "\n";
+
+  std::set<std::string> applicants;
+  size_t before = heap_in_use();
+  time_func(
+    "get_applicants (std::set)",
+    [&] { applicants = get_applicants(path.string()); },
+    lines);
+  print_memory(heap_in_use() - before, applicants.size());
+
+  ApplicantStore store;
+  before = heap_in_use();
+  time_func(
+    "ApplicantStore", [&] { store = ApplicantStore(path.string()); }, lines);
+  print_memory(heap_in_use() - before, store.size());
+  std::filesystem::remove(path);
+
+  if (!std::ranges::equal(applicants, store.names())) {
+    std::cerr << "ApplicantStore holds different names than the set!\n";
+    return 1;
+  }
+
+  InitialsIndex<> index;
+  before = heap_in_use();
+  time_func(
+    "build InitialsIndex", [&] { index = InitialsIndex<>(applicants); }, lines);
+  print_memory(heap_in_use() - before, index.size());
+
+  InitialsIndex<ApplicantStore::Id> id_index;
+  before = heap_in_use();
+  time_func(
+    "build InitialsIndex (ApplicantStore IDs)",
+    [&] { id_index = index_ids(store); },
+    lines);
+  print_memory(heap_in_use() - before, id_index.size());
+
+  std::vector<const std::string*> names;
+  names.reserve(applicants.size());
+  for (const auto& name : applicants)
+    names.push_back(&name);
+  std::mt19937 rng(106);
+  std::uniform_int_distribution<size_t> pick(0, names.size() - 1);
+
+  constexpr size_t kQueries = 100000;
+  std::vector<std::string> queries;
+  for (size_t i = 0; i < kQueries; ++i)
+    queries.push_back(*names[pick(rng)]);
+
+  size_t indexed_matches = 0;
+  time_func(
+    "find_matches (InitialsIndex)",
+    [&] {
+      for (const auto& query : queries)
+        indexed_matches += find_matches(query, index).size();
+    },
+    kQueries);
+  std::cout << "  " << indexed_matches / kQueries << " matches per query\n";
+
+  size_t spans = 0;
+  time_func(
+    "InitialsIndex::find (no queue)",
+    [&] {
+      for (const auto& query : queries)
+        spans += index.find(query).size();
+    },
+    kQueries);
+
+  constexpr size_t kSetQueries = 3;
+  std::vector<std::queue<const std::string*>> set_matches;
+  time_func(
+    "find_matches (walk std::set)",
+    [&] {
+      for (size_t i = 0; i < kSetQueries; ++i)
+        set_matches.push_back(find_matches(queries[i], applicants));
+    },
+    kSetQueries);
+
+  bool same = spans == indexed_matches;
+  for (size_t i = 0; i < kSetQueries; ++i)
+    same = same && find_matches(queries[i], index) == set_matches[i];
+  if (!same) {
+    std::cerr << "InitialsIndex found different matches than the set!\n";
+    return 1;
+  }
+  for (size_t i = 0; i < kSetQueries; ++i) {
+    if (!same_names(id_index.find(queries[i]), index.find(queries[i]), store)) {
+      std::cerr << "The ID InitialsIndex found different names than the "
+                   "pointer one!\n";
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Checks that `find_matches` with an InitialsIndex returns the same names, in
+ * the same order, as `find_matches` walking the set, for every applicant in
+ * students.txt and for a few names that can't match anyone. Also checks that
+ * an index of `ApplicantStore` IDs finds the same names as one of pointers.
+ */
+int
+run_index_check()
+{
+  auto applicants = get_applicants("students.txt");
+  if (applicants.empty()) {
+    std::cerr << "Run the check from the assignment2 directory.\n";
+    return 1;
+  }
+  InitialsIndex<> index(applicants);
+  ApplicantStore store("students.txt");
+  auto id_index = index_ids(store);
+
+  std::vector<std::string> queries(applicants.begin(), applicants.end());
+  queries.insert(queries.end(), { "", "Cher", "Ludwig van Beethoven", "zz zz" });
+  for (const auto& query : queries) {
+    if (find_matches(query, index) != find_matches(query, applicants)) {
+      std::cerr << "find_matches with an InitialsIndex disagrees with the set for \""
+                << query << "\"!\n";
+      return 1;
+    }
+    if (!same_names(id_index.find(query), index.find(query), store)) {
+      std::cerr << "The ID InitialsIndex disagrees with the pointer one for \""
+                << query << "\"!\n";
+      return 1;
+    }
+  }
+  std::cout << "find_matches with an InitialsIndex matches the set for "
+            << queries.size() << " names\n";
+  return 0;
+}
+
+/**
+ * Loads a generated applicant file and matches every applicant with
+ * `stable_match`, then checks that the matching is one-to-one, only pairs
+ * applicants with the same initials, and is stable.
+ */
+int
+run_match_benchmark(size_t lines)
+{
+  auto path = std::filesystem::temp_directory_path() / "cs106l_applicants.txt";
+  write_applicant_file(path, lines);
+  ApplicantStore applicants(path.string());
+  std::filesystem::remove(path);
+  std::vector<std::string_view> names(applicants.names().begin(),
+                                      applicants.names().end());
+  std::cout << "Applicants: " << names.size() << ", "
+            << std::thread::hardware_concurrency() << " hardware threads\n";
+
+  std::vector<uint32_t> partner;
+  time_func(
+    "stable_match", [&] { partner = stable_match(names); }, names.size());
+
+  size_t matched = 0;
+  for (uint32_t id = 0; id < names.size(); ++id) {
+    if (partner[id] == kUnmatched)
+      continue;
+    ++matched;
+    if (partner[partner[id]] != id ||
+        get_initials(names[id]) != get_initials(names[partner[id]])) {
+      std::cerr << "stable_match paired " << names[id] << " badly!\n";
+      return 1;
+    }
+  }
+  std::cout << "  " << matched << " matched (" << std::setprecision(2)
+            << 100.0 * matched / names.size() << "%)\n";
+
+  if (auto pair = find_blocking_pair(names, partner)) {
+    std::cerr << "stable_match isn't stable: " << names[pair->first]
+              << " and " << names[pair->second]
+              << " would rather be with each other!\n";
+    return 1;
+  }
+  std::cout << "  no blocking pairs\n";
+  return 0;
+}
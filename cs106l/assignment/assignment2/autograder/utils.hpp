@@ -2,6 +2,7 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <string_view>
 
 int
 run_autograder()
@@ -67,8 +68,16 @@ run_autograder()
   return run_program(python, { "autograder/autograder.py" });
 }
 
+#include "benchmarks.hpp"
+
 int
-main()
+main(int argc, char* argv[])
 {
+  if (argc >= 2 && argc <= 3 && std::string_view(argv[1]) == "--benchmark")
+    return run_benchmarks(argc == 3 ? std::stoul(argv[2]) : 10000000);
+  if (argc >= 2 && argc <= 3 && std::string_view(argv[1]) == "--benchmark-match")
+    return run_match_benchmark(argc == 3 ? std::stoul(argv[2]) : 1000000);
+  if (argc == 2 && std::string_view(argv[1]) == "--check-index")
+    return run_index_check();
   return run_autograder();
 }
\ No newline at end of file
@@ -0,0 +1,119 @@
+/*
+ * CS106L Assignment 2: Marriage Pact
+ *
+ * An index from initials to the names that have them.
+ */
+
+#pragma once
+
+#include <cctype>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * Returns the initials of a name made of exactly two words (a first and a last
+ * name), or `std::nullopt` for any other name.
+ */
+inline std::optional<std::pair<char, char>>
+get_initials(std::string_view name)
+{
+  auto is_space = [](char c) { return std::isspace(static_cast<unsigned char>(c)) != 0; };
+
+  std::optional<char> first, last;
+  size_t words = 0;
+  for (size_t i = 0; i < name.size(); ++i) {
+    if (!is_space(name[i]) && (i == 0 || is_space(name[i - 1]))) {
+      (words == 0 ? first : last) = name[i];
+      if (++words > 2)
+        return std::nullopt;
+    }
+  }
+  if (words != 2)
+    return std::nullopt;
+  return std::make_pair(*first, *last);
+}
+
+/**
+ * Groups names by their initials, so that all names sharing a name's initials
+ * can be found in time proportional to the number of such names.
+ *
+ * The names are laid out like a counting sort: one array holds a handle to
+ * every name, grouped by initials, and a table of 65536 offsets (one per pair
+ * of initials) gives where each group starts. Names without initials (see
+ * `get_initials`) are left out. By default the handles are pointers into the
+ * container the index was built from, which must then outlive it and not
+ * change; they can also be IDs, such as an `ApplicantStore::Id`.
+ */
+template<typename Handle = const std::string*>
+class InitialsIndex
+{
+public:
+  InitialsIndex() = default;
+
+  /** Builds the index over a container of `std::string`, keeping its order. */
+  template<typename Names>
+  explicit InitialsIndex(const Names& names)
+    : InitialsIndex(names, [](const std::string& name, size_t) { return &name; })
+  {
+  }
+
+  /**
+   * Builds the index over any range of names, keeping its order.
+   * `make_handle(name, position)` returns the handle to store for the name at
+   * the given position in the range.
+   */
+  template<typename Names, typename MakeHandle>
+  InitialsIndex(const Names& names, MakeHandle make_handle)
+    : offsets(kBuckets + 1, 0)
+  {
+    // First count the names in each bucket, then turn the counts into offsets
+    std::vector<uint32_t> buckets;
+    for (auto&& name : names) {
+      auto initials = get_initials(name);
+      buckets.push_back(initials ? bucket(*initials) : kBuckets);
+      if (initials)
+        ++offsets[buckets.back() + 1];
+    }
+    for (size_t i = 1; i <= kBuckets; ++i)
+      offsets[i] += offsets[i - 1];
+
+    entries.resize(offsets[kBuckets]);
+    std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+    size_t position = 0;
+    for (auto&& name : names) {
+      if (uint32_t b = buckets[position]; b != kBuckets)
+        entries[next[b]++] = make_handle(name, position);
+      ++position;
+    }
+  }
+
+  /** Returns every indexed name with the same initials as `name`. */
+  std::span<const Handle> find(std::string_view name) const
+  {
+    auto initials = get_initials(name);
+    if (!initials || entries.empty())
+      return {};
+    size_t b = bucket(*initials);
+    return { entries.data() + offsets[b], entries.data() + offsets[b + 1] };
+  }
+
+  /** The number of names in the index. */
+  size_t size() const { return entries.size(); }
+
+private:
+  static constexpr size_t kBuckets = 1 << 16;
+
+  static size_t bucket(std::pair<char, char> initials)
+  {
+    return static_cast<unsigned char>(initials.first) << 8 |
+           static_cast<unsigned char>(initials.second);
+  }
+
+  std::vector<uint32_t> offsets;
+  std::vector<Handle> entries;
+};
@@ -10,10 +10,15 @@
 #include <fstream>
 #include <iostream>
 #include <queue>
+#include <random>
 #include <set>
 #include <string>
 #include <unordered_set>
 
+#include "applicant_store.h"
+#include "initials_index.h"
+#include "stable_matching.h"
+
 std::string kYourName = "STUDENT TODO"; // Don't forget to change this!
 
 /**
@@ -28,7 +33,14 @@ std::string kYourName = "STUDENT TODO"; // Don't forget to change this!
  * to also change the corresponding functions in `utils.h`.
  */
 std::set<std::string> get_applicants(std::string filename) {
-  // STUDENT TODO: Implement this function.
+  std::set<std::string> applicants;
+  std::ifstream file(filename);
+  std::string line;
+  while (std::getline(file, line)) {
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (!line.empty()) applicants.insert(line);
+  }
+  return applicants;
 }
 
 /**
@@ -40,7 +52,29 @@ std::set<std::string> get_applicants(std::string filename) {
  * @return          A queue containing pointers to each matching name.
  */
 std::queue<const std::string*> find_matches(std::string name, std::set<std::string>& students) {
-  // STUDENT TODO: Implement this function.
+  std::queue<const std::string*> matches;
+  auto initials = get_initials(name);
+  if (!initials) return matches;
+
+  for (const std::string& student : students) {
+    if (get_initials(student) == initials) matches.push(&student);
+  }
+  return matches;
+}
+
+/**
+ * Does the same as `find_matches` above, but looks the initials up in an
+ * `InitialsIndex` built over the students, so it only touches the names that
+ * match instead of every student.
+ *
+ * @param name      The returned queue of names should have the same initials as this name.
+ * @param index     An index built over the set of student names.
+ * @return          A queue containing pointers to each matching name.
+ */
+std::queue<const std::string*> find_matches(std::string name, const InitialsIndex<>& index) {
+  std::queue<const std::string*> matches;
+  for (const std::string* student : index.find(name)) matches.push(student);
+  return matches;
 }
 
 /**
@@ -54,7 +88,13 @@ std::queue<const std::string*> find_matches(std::string name, std::set<std::stri
  *                Will return "NO MATCHES FOUND." if `matches` is empty.
  */
 std::string get_match(std::queue<const std::string*>& matches) {
-  // STUDENT TODO: Implement this function.
+  if (matches.empty()) return "NO MATCHES FOUND.";
+
+  // Everyone in the queue gets an equal chance
+  std::mt19937 rng(std::random_device{}());
+  size_t chosen = std::uniform_int_distribution<size_t>(0, matches.size() - 1)(rng);
+  for (size_t i = 0; i < chosen; ++i) matches.pop();
+  return *matches.front();
 }
 
 /* #### Please don't remove this line! #### */
@@ -0,0 +1,280 @@
+/*
+ * CS106L Assignment 2: Marriage Pact
+ *
+ * Matches the whole applicant pool at once, so that no two applicants would
+ * both rather be with each other than with who they were matched to.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "initials_index.h"
+
+/** Tuning knobs for `stable_match`. */
+struct MatchOptions
+{
+  /** How many partners each proposer ranks. Longer lists match more people. */
+  size_t candidates = 16;
+  /**
+   * How many potential partners each proposer looks at to pick its
+   * `candidates` favourites. Bounds the work per applicant in large groups.
+   */
+  size_t window = 256;
+  /** Changes every preference, giving a different (but still stable) matching. */
+  uint64_t seed = 106;
+  /** Threads used to build the preference lists. */
+  size_t threads = std::max(1u, std::thread::hardware_concurrency());
+};
+
+/** The partner of an applicant that `stable_match` could not match. */
+inline constexpr uint32_t kUnmatched = std::numeric_limits<uint32_t>::max();
+
+namespace stable_matching_detail {
+
+/** The splitmix64 finalizer: a cheap, well-mixed 64-bit hash. */
+inline uint64_t
+mix(uint64_t x)
+{
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+/** FNV-1a, used so preferences depend on names rather than on their order. */
+inline uint64_t
+hash_name(std::string_view name)
+{
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (unsigned char c : name)
+    hash = (hash ^ c) * 0x100000001b3ULL;
+  return hash;
+}
+
+/**
+ * Who each proposer would like to be matched with, as computed for
+ * `stable_match` (see there).
+ */
+struct Preferences
+{
+  std::vector<uint64_t> hashes;    // per applicant id
+  std::vector<uint32_t> proposers; // applicant ids
+  size_t k = 0;                    // room in each preference list
+  std::vector<uint32_t> lists;     // proposer p's list is at [p * k, ...)
+  std::vector<uint32_t> list_sizes;
+
+  /** Lower is better: how much the applicant hashed to `from` likes `to`. */
+  static uint64_t hashed_score(uint64_t from, uint64_t to)
+  {
+    return mix(from * 0x9e3779b97f4a7c15ULL + to);
+  }
+
+  uint64_t score(uint32_t from, uint32_t to) const
+  {
+    return hashed_score(hashes[from], hashes[to]);
+  }
+};
+
+/** Splits `names` into proposers and receivers and ranks them. */
+inline Preferences
+build_preferences(std::span<const std::string_view> names,
+                  const MatchOptions& options)
+{
+  const size_t n = names.size();
+
+  Preferences prefs;
+  auto& hashes = prefs.hashes;
+  hashes.resize(n);
+  for (size_t id = 0; id < n; ++id)
+    hashes[id] = hash_name(names[id]) ^ options.seed;
+
+  // Group the ids by initials, ordered by hash within each group, then split
+  // each group into proposers (even positions) and receivers (odd positions)
+  struct Entry
+  {
+    uint32_t group;
+    uint64_t hash;
+    uint32_t id;
+
+    bool operator<(const Entry& other) const
+    {
+      return std::tie(group, hash, id) <
+             std::tie(other.group, other.hash, other.id);
+    }
+  };
+  std::vector<Entry> entries;
+  for (uint32_t id = 0; id < n; ++id) {
+    if (auto initials = get_initials(names[id])) {
+      uint32_t group = static_cast<unsigned char>(initials->first) << 8 |
+                       static_cast<unsigned char>(initials->second);
+      entries.push_back({ group, hashes[id], id });
+    }
+  }
+  std::sort(entries.begin(), entries.end());
+
+  auto& proposers = prefs.proposers;
+  std::vector<std::pair<uint32_t, uint32_t>> receiver_ranges; // per proposer
+  std::vector<uint32_t> receivers;
+  std::vector<uint64_t> receiver_hashes; // kept next to each other for the scan
+  for (size_t begin = 0; begin < entries.size();) {
+    size_t end = begin;
+    while (end < entries.size() && entries[end].group == entries[begin].group)
+      ++end;
+    auto first_receiver = static_cast<uint32_t>(receivers.size());
+    for (size_t i = begin + 1; i < end; i += 2) {
+      receivers.push_back(entries[i].id);
+      receiver_hashes.push_back(entries[i].hash);
+    }
+    auto last_receiver = static_cast<uint32_t>(receivers.size());
+    for (size_t i = begin; i < end; i += 2) {
+      proposers.push_back(entries[i].id);
+      receiver_ranges.emplace_back(first_receiver, last_receiver);
+    }
+    begin = end;
+  }
+
+  // Each proposer's preference list, best first
+  const size_t k = prefs.k = std::max<size_t>(options.candidates, 1);
+  auto& lists = prefs.lists;
+  auto& list_sizes = prefs.list_sizes;
+  lists.resize(proposers.size() * k);
+  list_sizes.resize(proposers.size());
+  auto build_lists = [&](size_t first, size_t last) {
+    std::vector<std::pair<uint64_t, uint32_t>> scored;
+    for (size_t p = first; p < last; ++p) {
+      auto [lo, hi] = receiver_ranges[p];
+      size_t count = hi - lo;
+      size_t window = std::min(count, std::max(options.window, k));
+      size_t start = count == 0 ? 0 : hashes[proposers[p]] % count;
+
+      uint64_t proposer_hash = hashes[proposers[p]];
+      scored.clear();
+      for (size_t i = start; i < start + window; ++i) {
+        size_t r = lo + (i < count ? i : i - count);
+        scored.emplace_back(Preferences::hashed_score(proposer_hash,
+                                                      receiver_hashes[r]),
+                            receivers[r]);
+      }
+      size_t keep = std::min(k, scored.size());
+      std::partial_sort(scored.begin(), scored.begin() + keep, scored.end());
+      for (size_t i = 0; i < keep; ++i)
+        lists[p * k + i] = scored[i].second;
+      list_sizes[p] = static_cast<uint32_t>(keep);
+    }
+  };
+
+  // Small pools are not worth starting threads for
+  size_t threads =
+    std::clamp<size_t>(options.threads, 1, proposers.size() / 1024 + 1);
+  std::vector<std::thread> workers;
+  for (size_t t = 1; t < threads; ++t) {
+    workers.emplace_back(build_lists,
+                         proposers.size() * t / threads,
+                         proposers.size() * (t + 1) / threads);
+  }
+  build_lists(0, proposers.size() / threads);
+  for (auto& worker : workers)
+    worker.join();
+  return prefs;
+}
+
+} // namespace stable_matching_detail
+
+/**
+ * Computes a stable one-to-one matching of the applicants in `names`, where
+ * applicant i is `names[i]`, and returns each applicant's partner (or
+ * `kUnmatched`).
+ *
+ * Only applicants with the same initials can be matched. Within each initials
+ * group, half of the applicants propose and the other half receive proposals,
+ * and the Gale–Shapley algorithm runs over those two halves. How much
+ * applicant a likes applicant b is a hash of both names, so the result does not
+ * depend on the order of `names`. Each proposer ranks its `candidates`
+ * favourite receivers among `window` of them; the matching is stable with
+ * respect to those lists. Building the lists is the expensive part, and is
+ * split across `threads` threads.
+ */
+inline std::vector<uint32_t>
+stable_match(std::span<const std::string_view> names,
+             const MatchOptions& options = {})
+{
+  using namespace stable_matching_detail;
+  const size_t n = names.size();
+  const Preferences prefs = build_preferences(names, options);
+  const auto& proposers = prefs.proposers;
+  const size_t k = prefs.k;
+
+  // Gale–Shapley: free proposers propose down their lists, and each receiver
+  // keeps the best proposal it has seen so far
+  std::vector<uint32_t> partner(n, kUnmatched);
+  std::vector<uint32_t> next_choice(proposers.size(), 0);
+  std::vector<uint32_t> proposer_of(n, kUnmatched); // id -> proposer index
+  for (uint32_t p = 0; p < proposers.size(); ++p)
+    proposer_of[proposers[p]] = p;
+
+  std::vector<uint32_t> single(proposers.size());
+  for (uint32_t p = 0; p < proposers.size(); ++p)
+    single[p] = static_cast<uint32_t>(proposers.size()) - 1 - p;
+  while (!single.empty()) {
+    uint32_t p = single.back();
+    if (next_choice[p] == prefs.list_sizes[p]) {
+      single.pop_back(); // Nobody left to ask
+      continue;
+    }
+    uint32_t proposer = proposers[p];
+    uint32_t r = prefs.lists[p * k + next_choice[p]++];
+    uint32_t current = partner[r];
+    if (current == kUnmatched) {
+      single.pop_back();
+    } else if (prefs.score(r, proposer) < prefs.score(r, current)) {
+      single.back() = proposer_of[current];
+      partner[current] = kUnmatched;
+    } else {
+      continue;
+    }
+    partner[r] = proposer;
+    partner[proposer] = r;
+  }
+  return partner;
+}
+
+/**
+ * Checks that `partner` (from `stable_match` with the same `options`) is
+ * stable: that no proposer and receiver on its list both prefer each other to
+ * who they were matched with. Tries every such pair, and returns the first
+ * one that blocks the matching, if any.
+ */
+inline std::optional<std::pair<uint32_t, uint32_t>>
+find_blocking_pair(std::span<const std::string_view> names,
+                   std::span<const uint32_t> partner,
+                   const MatchOptions& options = {})
+{
+  using namespace stable_matching_detail;
+  const Preferences prefs = build_preferences(names, options);
+  for (uint32_t p = 0; p < prefs.proposers.size(); ++p) {
+    uint32_t proposer = prefs.proposers[p];
+    for (uint32_t i = 0; i < prefs.list_sizes[p]; ++i) {
+      uint32_t r = prefs.lists[p * prefs.k + i];
+      // The list is best first, so the proposer prefers everyone before its
+      // partner (and everyone, if it has none)
+      if (r == partner[proposer])
+        break;
+      uint32_t current = partner[r];
+      if (current == kUnmatched ||
+          prefs.score(r, proposer) < prefs.score(r, current))
+        return std::pair(proposer, r);
+    }
+  }
+  return std::nullopt;
+}
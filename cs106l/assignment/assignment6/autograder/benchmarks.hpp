@@ -0,0 +1,321 @@
+/*
+ * Benchmarks for the CourseDatabase. Run them with `./main --benchmark`, ideally
+ * from an optimized build:
+ *
+ *   g++ -std=c++23 -O2 main.cpp -o main
+ *
+ * `./main --benchmark-loader [megabytes]` compares CSV loaders on a generated
+ * catalog (1024 MB by default), written to the system temporary directory.
+ */
+
+#pragma once
+
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Runs `f` once and prints the total time and the average time per operation,
+ * where `operations` is the number of operations `f` performs.
+ */
+template<typename Func>
+void
+time_func(const std::string& label, Func f, size_t operations)
+{
+  auto start = std::chrono::steady_clock::now();
+  f();
+  auto end = std::chrono::steady_clock::now();
+
+  auto ns =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  std::cout << std::left << std::setw(48) << label << std::right
+            << std::setw(10) << ns / 1000000 << "ms" << std::setw(12)
+            << std::fixed << std::setprecision(1)
+            << static_cast<double>(ns) / operations << "ns/op\n";
+}
+
+/**
+ * Returns the autograder catalog repeated `factor` times. Every copy after the
+ * first gets a " #<copy>" suffix so that titles stay unique.
+ */
+std::vector<Course>
+scaled_catalog(size_t factor)
+{
+  auto lines = read_lines("autograder/courses.csv");
+  std::vector<Course> courses;
+  courses.reserve((lines.size() - 1) * factor);
+  for (size_t copy = 0; copy < factor; ++copy) {
+    for (size_t i = 1; i < lines.size(); ++i) {
+      auto parts = split(lines[i], ',');
+      if (copy > 0)
+        parts[0] += " #" + std::to_string(copy);
+      courses.push_back(Course{ parts[0], parts[1], parts[2] });
+    }
+  }
+  return courses;
+}
+
+/**
+ * Looks titles up in a 1000x scaled catalog, through the title index and with a
+ * linear scan (as find_course would without an index).
+ */
+void
+benchmark_lookup(const CourseDatabase& db)
+{
+  const auto& courses = db.all_courses();
+  std::mt19937 rng(106);
+  std::uniform_int_distribution<size_t> pick(0, courses.size() - 1);
+
+  // Half of the queries hit, half miss
+  std::vector<std::string> queries;
+  for (size_t i = 0; i < 100000; ++i) {
+    auto title = courses[pick(rng)].title;
+    queries.push_back(i % 2 == 0 ? title : title + " (missing)");
+  }
+
+  size_t found = 0;
+  time_func(
+    "find_course (title index)",
+    [&] {
+      for (const auto& query : queries)
+        found += db.find_course(query).has_value();
+    },
+    queries.size());
+
+  constexpr size_t kLinearQueries = 200;
+  size_t found_linear = 0;
+  time_func(
+    "linear scan",
+    [&] {
+      for (size_t i = 0; i < kLinearQueries; ++i) {
+        auto it = std::find_if(
+          courses.begin(), courses.end(), [&](const Course& course) {
+            return course.title == queries[i];
+          });
+        found_linear += it != courses.end();
+      }
+    },
+    kLinearQueries);
+
+  if (found != queries.size() / 2 || found_linear != kLinearQueries / 2) {
+    std::cerr << "Title lookups returned the wrong results!\n";
+    std::exit(1);
+  }
+}
+
+/**
+ * Measures prefix and fuzzy search latency on the scaled catalog, using the
+ * first few characters of real titles and titles with two typos as queries.
+ */
+void
+benchmark_search(const CourseDatabase& db)
+{
+  const auto& courses = db.all_courses();
+  std::mt19937 rng(107);
+  std::uniform_int_distribution<size_t> pick(0, courses.size() - 1);
+
+  std::vector<std::string> prefixes, misspellings;
+  for (size_t i = 0; i < 2000; ++i) {
+    const auto& title = courses[pick(rng)].title;
+    prefixes.push_back(title.substr(0, 6));
+
+    auto typo = title;
+    std::uniform_int_distribution<size_t> position(0, typo.size() - 1);
+    typo[position(rng)] = 'q';
+    typo.erase(position(rng), 1);
+    misspellings.push_back(typo);
+  }
+
+  size_t found = 0;
+  time_func(
+    "find_courses_with_prefix (6 chars)",
+    [&] {
+      for (const auto& prefix : prefixes)
+        found += !db.find_courses_with_prefix(prefix).empty();
+    },
+    prefixes.size());
+
+  size_t found_similar = 0;
+  time_func(
+    "find_similar_courses (2 typos)",
+    [&] {
+      for (const auto& misspelling : misspellings)
+        found_similar += !db.find_similar_courses(misspelling).empty();
+    },
+    misspellings.size());
+
+  if (found != prefixes.size() || found_similar != misspellings.size()) {
+    std::cerr << "Title search missed courses that exist!\n";
+    std::exit(1);
+  }
+}
+
+/**
+ * Writes a catalog of at least `megabytes` MB built from the autograder catalog.
+ * Every tenth title is quoted and contains a comma, as exported titles
+ * sometimes do.
+ * @return The number of records written.
+ */
+size_t
+write_generated_catalog(const std::filesystem::path& path, size_t megabytes)
+{
+  auto lines = read_lines("autograder/courses.csv");
+  std::ofstream out(path, std::ios::binary);
+  out << lines[0] << "\n";
+
+  const size_t target = megabytes << 20;
+  size_t bytes = 0, records = 0;
+  std::string record;
+  for (size_t copy = 0; bytes < target; ++copy) {
+    for (size_t i = 1; i < lines.size() && bytes < target; ++i, ++records) {
+      auto parts = split(lines[i], ',');
+      record.clear();
+      if (records % 10 == 0)
+        record += "\"" + parts[0] + ", Part " + std::to_string(copy) + "\"";
+      else
+        record += parts[0] + " #" + std::to_string(copy);
+      record += "," + parts[1] + "," + parts[2] + "\n";
+      out << record;
+      bytes += record.size();
+    }
+  }
+  return records + 1;
+}
+
+/**
+ * Reads a generated catalog with the original loader (`read_lines` and a
+ * `split` per line) and with `MappedFile` and `CsvReader`.
+ */
+int
+run_loader_benchmark(size_t megabytes)
+{
+  auto path = std::filesystem::temp_directory_path() / "cs106l_courses.csv";
+  size_t records = write_generated_catalog(path, megabytes);
+  size_t bytes = std::filesystem::file_size(path);
+  std::cout << "Catalog: " << records << " records, " << (bytes >> 20)
+            << " MB\n";
+
+  size_t split_records = 0, split_bytes = 0;
+  time_func(
+    "read_lines + split",
+    [&] {
+      for (const auto& line : read_lines(path.string())) {
+        auto parts = split(line, ',');
+        split_bytes += parts[0].size();
+        ++split_records;
+      }
+    },
+    records);
+
+  size_t csv_records = 0, csv_bytes = 0;
+  time_func(
+    "MappedFile + CsvReader",
+    [&] {
+      MappedFile file(path.string());
+      CsvReader reader(file.text());
+      std::vector<std::string_view> fields;
+      while (reader.next(fields)) {
+        csv_bytes += fields[0].size();
+        ++csv_records;
+      }
+    },
+    records);
+
+  std::filesystem::remove(path);
+  if (split_records != records || csv_records != records) {
+    std::cerr << "Loaders read the wrong number of records!\n";
+    return 1;
+  }
+  // Quoted titles lose their quotes, and `split` cuts them at the comma
+  std::cout << "Title bytes: " << csv_bytes << " (CsvReader), " << split_bytes
+            << " (split)\n";
+  return 0;
+}
+
+/**
+ * Counts offered courses worth at least 3 units by scanning the courses'
+ * strings and by scanning the columnar table.
+ */
+void
+benchmark_filters(const CourseDatabase& db)
+{
+  const auto& courses = db.all_courses();
+  constexpr size_t kScans = 100;
+  const size_t operations = kScans * courses.size();
+
+  size_t from_structs = 0;
+  time_func(
+    "filter std::vector<Course> (offered, units >= 3)",
+    [&] {
+      for (size_t scan = 0; scan < kScans; ++scan) {
+        for (const Course& course : courses) {
+          int units = 0;
+          const auto& text = course.number_of_units;
+          std::from_chars(text.data(), text.data() + text.size(), units);
+          from_structs += course.quarter != "null" && units >= 3;
+        }
+      }
+    },
+    operations);
+
+  CourseTable table;
+  time_func(
+    "build CourseTable",
+    [&] {
+      table.reserve(courses.size());
+      for (const Course& course : courses)
+        table.append(course.title, course.number_of_units, course.quarter);
+    },
+    courses.size());
+
+  CourseTable::Filter filter{ .quarter = std::nullopt,
+                              .offered = true,
+                              .min_units = 3 };
+  size_t from_columns = 0;
+  time_func(
+    "CourseTable::count (offered, units >= 3)",
+    [&] {
+      for (size_t scan = 0; scan < kScans; ++scan)
+        from_columns += table.count(filter);
+    },
+    operations);
+
+  size_t selected = 0;
+  time_func(
+    "CourseTable::select (offered, units >= 3)",
+    [&] {
+      for (size_t scan = 0; scan < kScans; ++scan)
+        selected += table.select(filter).size();
+    },
+    operations);
+
+  if (from_columns != from_structs || selected != from_structs ||
+      db.filter_courses(filter).size() * kScans != from_structs) {
+    std::cerr << "Course filters returned the wrong results!\n";
+    std::exit(1);
+  }
+}
+
+int
+run_benchmarks()
+{
+  auto courses = scaled_catalog(1000);
+  size_t num_courses = courses.size();
+  std::cout << "Catalog: " << num_courses << " courses\n";
+
+  std::optional<CourseDatabase> db;
+  time_func(
+    "build indexes", [&] { db.emplace(std::move(courses)); }, num_courses);
+
+  benchmark_lookup(*db);
+  benchmark_search(*db);
+  benchmark_filters(*db);
+  return 0;
+}
@@ -0,0 +1,211 @@
+/*
+ * CS106L Assignment 6: Explore Courses
+ *
+ * A column-oriented copy of the course catalog for fast filtering.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * Stores courses as columns instead of as `Course` structs:
+ *
+ *  - titles are packed end to end in one string, found through an offsets array;
+ *  - units are parsed into 16-bit integers;
+ *  - quarters are dictionary encoded, so each row stores a 16-bit code into a
+ *    list of distinct quarter names.
+ *
+ * A filter over units and quarter then reads two small integer arrays instead
+ * of every course's strings, and is evaluated eight rows at a time with SSE2.
+ * Rows are numbered in the order they were appended.
+ */
+class CourseTable
+{
+public:
+  /** The units stored for a course whose units are not a number. */
+  static constexpr int16_t kUnknownUnits = -1;
+
+  /** Which rows `select` and `count` keep. Every condition must hold. */
+  struct Filter
+  {
+    /** Keep only courses offered in this quarter, if given. */
+    std::optional<std::string_view> quarter;
+    /** Keep only courses that are offered at all (quarter is not "null"). */
+    bool offered = false;
+    int min_units = std::numeric_limits<int16_t>::min();
+    int max_units = std::numeric_limits<int16_t>::max();
+  };
+
+  /** Adds a row to the end of the table. */
+  void append(std::string_view title,
+              std::string_view number_of_units,
+              std::string_view quarter)
+  {
+    title_heap.append(title);
+    title_ends.push_back(title_heap.size());
+
+    const char* last = number_of_units.data() + number_of_units.size();
+    int units = kUnknownUnits;
+    auto [end, error] = std::from_chars(number_of_units.data(), last, units);
+    if (error != std::errc{} || end != last || units < 0 ||
+        units > std::numeric_limits<int16_t>::max())
+      units = kUnknownUnits;
+    units_column.push_back(static_cast<int16_t>(units));
+
+    auto code = quarter_code(quarter);
+    if (!code) {
+      if (quarter_names.size() >= kNoQuarter)
+        throw std::length_error("CourseTable: too many distinct quarters");
+      code = static_cast<uint16_t>(quarter_names.size());
+      quarter_names.emplace_back(quarter);
+    }
+    quarter_column.push_back(*code);
+  }
+
+  void reserve(size_t rows, size_t title_bytes = 0)
+  {
+    title_ends.reserve(rows);
+    units_column.reserve(rows);
+    quarter_column.reserve(rows);
+    title_heap.reserve(title_bytes);
+  }
+
+  size_t size() const { return units_column.size(); }
+
+  std::string_view title(size_t row) const
+  {
+    size_t begin = row == 0 ? 0 : title_ends[row - 1];
+    return std::string_view(title_heap).substr(begin, title_ends[row] - begin);
+  }
+
+  /** The course's units, or `kUnknownUnits` if they are not a number. */
+  int16_t units(size_t row) const { return units_column[row]; }
+
+  std::string_view quarter(size_t row) const
+  {
+    return quarter_names[quarter_column[row]];
+  }
+
+  /** Returns the rows that satisfy `filter`, in increasing order. */
+  std::vector<uint32_t> select(const Filter& filter) const
+  {
+    std::vector<uint32_t> rows;
+    scan(filter, [&](uint32_t base, unsigned mask) {
+      for (; mask != 0; mask &= mask - 1)
+        rows.push_back(base + std::countr_zero(mask));
+    });
+    return rows;
+  }
+
+  /** Returns the number of rows that satisfy `filter`. */
+  size_t count(const Filter& filter) const
+  {
+    size_t total = 0;
+    scan(filter, [&](uint32_t, unsigned mask) { total += std::popcount(mask); });
+    return total;
+  }
+
+private:
+  /** A quarter code that no row has. */
+  static constexpr uint16_t kNoQuarter = std::numeric_limits<uint16_t>::max();
+
+  std::optional<uint16_t> quarter_code(std::string_view quarter) const
+  {
+    // There are only a handful of distinct quarters, so a linear search wins
+    for (size_t code = 0; code < quarter_names.size(); ++code) {
+      if (quarter_names[code] == quarter)
+        return static_cast<uint16_t>(code);
+    }
+    return std::nullopt;
+  }
+
+  /**
+   * Evaluates `filter` over every row and calls `emit(base, mask)` for each
+   * block of up to eight rows starting at `base`, where bit i of `mask` is set
+   * if row `base + i` matches.
+   */
+  template<typename Emit>
+  void scan(const Filter& filter, Emit emit) const
+  {
+    constexpr int kMin = std::numeric_limits<int16_t>::min();
+    constexpr int kMax = std::numeric_limits<int16_t>::max();
+    if (filter.min_units > kMax || filter.max_units < kMin)
+      return;
+    auto min_units = static_cast<int16_t>(std::max(filter.min_units, kMin));
+    auto max_units = static_cast<int16_t>(std::min(filter.max_units, kMax));
+
+    bool match_quarter = filter.quarter.has_value();
+    uint16_t wanted = kNoQuarter;
+    if (match_quarter) {
+      auto code = quarter_code(*filter.quarter);
+      if (!code)
+        return;
+      wanted = *code;
+    }
+    uint16_t unoffered = kNoQuarter;
+    if (filter.offered)
+      unoffered = quarter_code("null").value_or(kNoQuarter);
+
+    auto matches = [&](size_t row) {
+      int16_t units = units_column[row];
+      uint16_t code = quarter_column[row];
+      return units >= min_units && units <= max_units &&
+             (!match_quarter || code == wanted) && code != unoffered;
+    };
+
+    size_t row = 0;
+#if defined(__SSE2__)
+    const __m128i vmin = _mm_set1_epi16(min_units);
+    const __m128i vmax = _mm_set1_epi16(max_units);
+    const __m128i vwanted = _mm_set1_epi16(static_cast<int16_t>(wanted));
+    const __m128i vunoffered = _mm_set1_epi16(static_cast<int16_t>(unoffered));
+    const __m128i all = _mm_set1_epi16(-1);
+    for (; row + 8 <= size(); row += 8) {
+      __m128i units = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(units_column.data() + row));
+      __m128i codes = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(quarter_column.data() + row));
+
+      // Lanes are all ones where the row matches: min <= units <= max ...
+      __m128i keep = _mm_andnot_si128(_mm_cmpgt_epi16(vmin, units), all);
+      keep = _mm_andnot_si128(_mm_cmpgt_epi16(units, vmax), keep);
+      // ... the quarter is the wanted one, and it is not "null"
+      if (match_quarter)
+        keep = _mm_and_si128(keep, _mm_cmpeq_epi16(codes, vwanted));
+      keep = _mm_andnot_si128(_mm_cmpeq_epi16(codes, vunoffered), keep);
+
+      auto mask = static_cast<unsigned>(
+        _mm_movemask_epi8(_mm_packs_epi16(keep, _mm_setzero_si128())));
+      if (mask != 0)
+        emit(static_cast<uint32_t>(row), mask);
+    }
+#endif
+    for (; row < size(); row += 8) {
+      unsigned mask = 0;
+      for (size_t i = 0; i < 8 && row + i < size(); ++i)
+        mask |= static_cast<unsigned>(matches(row + i)) << i;
+      if (mask != 0)
+        emit(static_cast<uint32_t>(row), mask);
+    }
+  }
+
+  std::string title_heap;
+  std::vector<size_t> title_ends;
+  std::vector<int16_t> units_column;
+  std::vector<uint16_t> quarter_column;
+  std::vector<std::string> quarter_names;
+};
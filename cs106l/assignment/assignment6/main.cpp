@@ -5,10 +5,19 @@
  */
 
 #include <algorithm>
+#include <functional>
+#include <span>
+#include <string_view>
+#include <tuple>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
-/** STUDENT_TODO: You will need to include a relevant header file here! */
+#include <optional>
+
+#include "course_table.h"
+#include "csv_reader.h"
+#include "title_search.h"
 
 #include "autograder/utils.hpp"
 
@@ -32,36 +41,199 @@ struct Course
   }
 };
 
+/**
+ * A hash for course titles that can be called with any string-like type, so that
+ * the title index can be searched with a `std::string_view` (or a `std::string`,
+ * or a `const char*`) without constructing a temporary `std::string`.
+ */
+struct TitleHash
+{
+  using is_transparent = void;
+
+  size_t operator()(std::string_view title) const
+  {
+    return std::hash<std::string_view>{}(title);
+  }
+};
+
+/** A course found by a fuzzy title search, with its edit distance. */
+struct CourseMatch
+{
+  std::reference_wrapper<const Course> course;
+  size_t distance;
+};
+
+/**
+ * A read-only collection of courses, indexed by title and by quarter.
+ */
 class CourseDatabase
 {
 public:
   CourseDatabase(std::string filename)
   {
-    auto lines = read_lines(filename);
-    std::transform(lines.begin(),
-                   lines.end(),
-                   std::back_inserter(courses),
-                   [](std::string line) {
-                     auto parts = split(line, ',');
-                     return Course{ parts[0], parts[1], parts[2] };
-                   });
+    MappedFile file(filename);
+    if (!file.is_open()) {
+      std::cerr << "Could not open file " << filename << "\n";
+      std::exit(1);
+    }
+
+    CsvReader reader(file.text());
+    std::vector<std::string_view> fields;
+    while (reader.next(fields)) {
+      fields.resize(3);
+      courses.push_back(Course{ csv_unescape(fields[0]),
+                                csv_unescape(fields[1]),
+                                csv_unescape(fields[2]) });
+    }
+    build_indexes();
+  }
+
+  CourseDatabase(std::vector<Course> courses)
+    : courses(std::move(courses))
+  {
+    build_indexes();
   }
 
+  /* The indexes point into `courses`, so a copy would point into the original */
+  CourseDatabase(const CourseDatabase&) = delete;
+  CourseDatabase& operator=(const CourseDatabase&) = delete;
+  CourseDatabase(CourseDatabase&&) = default;
+  CourseDatabase& operator=(CourseDatabase&&) = default;
+
   /**
    * Finds a course in the database with the given title, if it exists.
+   * Runs in expected O(1) time using the title index.
    * @param course_title The title of the course to find.
-   * @return You will need to figure this out!
+   * @return A reference to the course, or `std::nullopt` if there is none.
+   *         The reference is valid for as long as the database is.
+   */
+  std::optional<std::reference_wrapper<const Course>> find_course(
+    std::string_view course_title) const
+  {
+    auto it = by_title.find(course_title);
+    if (it == by_title.end())
+      return std::nullopt;
+    return std::cref(*it->second);
+  }
+
+  /**
+   * Returns every course offered in the given quarter, ordered by title.
+   * @param quarter A quarter such as "2023-2024 Winter", or "null" for courses
+   *                that are not offered.
+   */
+  std::span<const Course* const> courses_in_quarter(std::string_view quarter) const
+  {
+    auto [first, last] = std::equal_range(
+      by_quarter.begin(), by_quarter.end(), quarter, QuarterOrder{});
+    return { first, last };
+  }
+
+  /**
+   * Finds courses whose title starts with `prefix`, ignoring case.
+   * @param prefix The beginning of the title, e.g. what a user has typed so far.
+   * @param limit The maximum number of courses to return.
+   * @return Up to `limit` courses in alphabetical order of title.
+   */
+  std::vector<std::reference_wrapper<const Course>> find_courses_with_prefix(
+    std::string_view prefix,
+    size_t limit = 10) const
+  {
+    std::vector<std::reference_wrapper<const Course>> results;
+    for (auto id : title_search.prefix(prefix, limit))
+      results.push_back(std::cref(courses[id]));
+    return results;
+  }
+
+  /**
+   * Finds courses whose title is within a few typos of `title`, ignoring case.
+   * @param title The (possibly misspelled) title to search for.
+   * @param max_distance The maximum number of inserted, deleted or substituted
+   *                     characters.
+   * @param limit The maximum number of courses to return.
+   * @return Up to `limit` courses, closest match first.
    */
-  FillMeIn find_course(std::string course_title)
+  std::vector<CourseMatch> find_similar_courses(std::string_view title,
+                                                size_t max_distance = 2,
+                                                size_t limit = 10) const
   {
-    /* STUDENT_TODO: Implement this method! You will need to change the return
-     * type. */
+    std::vector<CourseMatch> results;
+    for (auto match : title_search.fuzzy(title, max_distance, limit))
+      results.push_back({ std::cref(courses[match.id]), match.distance });
+    return results;
   }
 
+  /**
+   * Returns the courses that satisfy `filter`, in the order they were loaded.
+   * For example, `{ .offered = true, .min_units = 3 }` finds every offered
+   * course worth at least 3 units. Runs a vectorized scan over the columnar
+   * copy of the catalog, so no course's strings are read.
+   */
+  std::vector<std::reference_wrapper<const Course>> filter_courses(
+    const CourseTable::Filter& filter) const
+  {
+    std::vector<std::reference_wrapper<const Course>> results;
+    for (auto row : table.select(filter))
+      results.push_back(std::cref(courses[row]));
+    return results;
+  }
+
+  /** Returns all courses in the order they were loaded. */
+  const std::vector<Course>& all_courses() const { return courses; }
+
 private:
+  /**
+   * Orders courses by quarter, then title. Also compares a course against a bare
+   * quarter so that `std::equal_range` can search by quarter alone.
+   */
+  struct QuarterOrder
+  {
+    bool operator()(const Course* a, const Course* b) const
+    {
+      return std::tie(a->quarter, a->title) < std::tie(b->quarter, b->title);
+    }
+    bool operator()(const Course* a, std::string_view quarter) const
+    {
+      return a->quarter < quarter;
+    }
+    bool operator()(std::string_view quarter, const Course* b) const
+    {
+      return quarter < b->quarter;
+    }
+  };
+
+  /**
+   * Builds the title and quarter indexes and the columnar table. The indexes
+   * point into `courses`, which is never modified afterwards, so the pointers
+   * and title views stay valid.
+   */
+  void build_indexes()
+  {
+    by_title.reserve(courses.size());
+    by_quarter.reserve(courses.size());
+    table.reserve(courses.size());
+    std::vector<std::string_view> titles;
+    titles.reserve(courses.size());
+    for (const Course& course : courses) {
+      // Keep the first course with a given title, like a linear search would
+      by_title.try_emplace(course.title, &course);
+      by_quarter.push_back(&course);
+      titles.push_back(course.title);
+      table.append(course.title, course.number_of_units, course.quarter);
+    }
+    std::sort(by_quarter.begin(), by_quarter.end(), QuarterOrder{});
+    title_search = TitleSearchIndex(titles);
+  }
+
   std::vector<Course> courses;
+  std::unordered_map<std::string_view, const Course*, TitleHash, std::equal_to<>>
+    by_title;
+  std::vector<const Course*> by_quarter;
+  TitleSearchIndex title_search;
+  CourseTable table;
 };
 
+#include "autograder/benchmarks.hpp"
+
 int
 main(int argc, char* argv[])
 {
@@ -72,16 +244,52 @@ main(int argc, char* argv[])
     "You must change the return type of CourseDatabase::find_course to "
     "something other than FillMeIn.");
 
+  if (argc == 2 && std::string_view(argv[1]) == "--benchmark")
+    return run_benchmarks();
+
+  if (argc >= 2 && argc <= 3 &&
+      std::string_view(argv[1]) == "--benchmark-loader")
+    return run_loader_benchmark(argc == 3 ? std::stoul(argv[2]) : 1024);
+
+  if (argc == 3 && (std::string_view(argv[1]) == "--prefix" ||
+                    std::string_view(argv[1]) == "--fuzzy")) {
+    CourseDatabase db("autograder/courses.csv");
+    auto print = [](const Course& course) {
+      std::cout << course.title << "," << course.number_of_units << ","
+                << course.quarter;
+    };
+
+    size_t found = 0;
+    if (std::string_view(argv[1]) == "--prefix") {
+      for (const Course& course : db.find_courses_with_prefix(argv[2])) {
+        print(course);
+        std::cout << "\n";
+        ++found;
+      }
+    } else {
+      for (const auto& [course, distance] : db.find_similar_courses(argv[2])) {
+        print(course);
+        std::cout << " (distance " << distance << ")\n";
+        ++found;
+      }
+    }
+
+    if (found == 0)
+      std::cout << "No courses found.\n";
+    return 0;
+  }
+
   if (argc == 2) {
     CourseDatabase db("autograder/courses.csv");
     auto course = db.find_course(argv[1]);
     
-    /******************************************************** 
-    STUDENT_TODO: Populate the output string with the right information to print
-    Please pay special attention to the README here
-    ********************************************************/
-
-    std::string output = /* STUDENT_TODO */
+    std::string output =
+      course
+        .transform([](const Course& course) {
+          return "Found course: " + course.title + "," +
+                 course.number_of_units + "," + course.quarter;
+        })
+        .value_or("Course not found.");
 
     /********************************************************
      DO NOT MODIFY ANYTHING BELOW THIS LINE PLEASE
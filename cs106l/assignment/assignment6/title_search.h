@@ -0,0 +1,237 @@
+/*
+ * CS106L Assignment 6: Explore Courses
+ *
+ * Prefix and fuzzy (edit distance) search over a fixed list of course titles.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Searches a fixed list of titles by prefix and by edit distance, ignoring case.
+ * Titles are referred to by their position (id) in the list given to the
+ * constructor.
+ *
+ * Prefix search binary searches a sorted array of the titles. Fuzzy search
+ * uses an inverted index of trigrams (three-character substrings) to find
+ * candidates, then computes the exact edit distance for each candidate only.
+ */
+class TitleSearchIndex
+{
+public:
+  /** A title found by a fuzzy search, with its edit distance from the query. */
+  struct Match
+  {
+    size_t id;
+    size_t distance;
+  };
+
+  TitleSearchIndex() = default;
+
+  explicit TitleSearchIndex(const std::vector<std::string_view>& titles)
+  {
+    folded.reserve(titles.size());
+    for (auto title : titles)
+      folded.push_back(fold(title));
+
+    sorted_ids.resize(folded.size());
+    for (uint32_t id = 0; id < sorted_ids.size(); ++id)
+      sorted_ids[id] = id;
+    std::sort(sorted_ids.begin(), sorted_ids.end(), [&](uint32_t a, uint32_t b) {
+      return folded[a] < folded[b];
+    });
+
+    for (uint32_t id = 0; id < folded.size(); ++id) {
+      for (auto gram : distinct_trigrams(folded[id]))
+        postings[gram].push_back(id);
+    }
+  }
+
+  /**
+   * Returns up to `limit` titles that start with `prefix`, in alphabetical
+   * order (so an exact match, if any, comes first).
+   * Runs in O(log n + limit) time.
+   */
+  std::vector<size_t> prefix(std::string_view prefix, size_t limit) const
+  {
+    auto key = fold(prefix);
+    auto it = std::lower_bound(
+      sorted_ids.begin(), sorted_ids.end(), key, [&](uint32_t id, const std::string& target) {
+        return folded[id] < target;
+      });
+
+    std::vector<size_t> results;
+    for (; it != sorted_ids.end() && results.size() < limit; ++it) {
+      if (!folded[*it].starts_with(key))
+        break;
+      results.push_back(*it);
+    }
+    return results;
+  }
+
+  /**
+   * Returns up to `limit` titles within `max_distance` edits (insertions,
+   * deletions or substitutions) of `query`, closest first and then in
+   * alphabetical order.
+   */
+  std::vector<Match> fuzzy(std::string_view query,
+                           size_t max_distance,
+                           size_t limit) const
+  {
+    auto key = fold(query);
+    auto grams = distinct_trigrams(key);
+
+    /* A single edit changes at most three trigrams, so any title within
+     * `max_distance` edits still contains all but 3 * max_distance of the
+     * query's distinct trigrams. Hence it must contain at least one of any
+     * 3 * max_distance + 1 of them: scanning the postings of the rarest ones
+     * finds every candidate. Short queries have too few trigrams for this
+     * to filter anything, so they fall back to scanning every title.
+     *
+     * Titles whose length differs from the query's by more than
+     * `max_distance` cannot match either, and are dropped right away.
+     */
+    auto close_in_length = [&](uint32_t id) {
+      size_t length = folded[id].size();
+      return length + max_distance >= key.size() && length <= key.size() + max_distance;
+    };
+
+    std::vector<uint32_t> candidates;
+    size_t needed = 3 * max_distance + 1;
+    if (grams.size() >= needed) {
+      std::vector<const std::vector<uint32_t>*> lists;
+      for (auto gram : grams) {
+        auto it = postings.find(gram);
+        lists.push_back(it == postings.end() ? &kNoPostings : &it->second);
+      }
+      std::partial_sort(lists.begin(),
+                        lists.begin() + needed,
+                        lists.end(),
+                        [](auto* a, auto* b) { return a->size() < b->size(); });
+      for (size_t i = 0; i < needed; ++i)
+        std::copy_if(lists[i]->begin(),
+                     lists[i]->end(),
+                     std::back_inserter(candidates),
+                     close_in_length);
+      std::sort(candidates.begin(), candidates.end());
+      candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                       candidates.end());
+    } else {
+      for (uint32_t id = 0; id < folded.size(); ++id) {
+        if (close_in_length(id))
+          candidates.push_back(id);
+      }
+    }
+
+    std::vector<Match> results;
+    std::vector<size_t> scratch;
+    for (auto id : candidates) {
+      size_t distance = bounded_edit_distance(key, folded[id], max_distance, scratch);
+      if (distance <= max_distance)
+        results.push_back({ id, distance });
+    }
+
+    auto closer = [&](const Match& a, const Match& b) {
+      if (a.distance != b.distance)
+        return a.distance < b.distance;
+      return folded[a.id] < folded[b.id];
+    };
+    if (results.size() > limit) {
+      std::partial_sort(
+        results.begin(), results.begin() + limit, results.end(), closer);
+      results.resize(limit);
+    } else {
+      std::sort(results.begin(), results.end(), closer);
+    }
+    return results;
+  }
+
+private:
+  static inline const std::vector<uint32_t> kNoPostings;
+
+  static std::string fold(std::string_view text)
+  {
+    std::string folded(text);
+    for (char& c : folded)
+      c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return folded;
+  }
+
+  static std::vector<uint32_t> distinct_trigrams(std::string_view text)
+  {
+    std::vector<uint32_t> grams;
+    for (size_t i = 0; i + 3 <= text.size(); ++i) {
+      grams.push_back(static_cast<uint32_t>(static_cast<unsigned char>(text[i])) << 16 |
+                      static_cast<uint32_t>(static_cast<unsigned char>(text[i + 1])) << 8 |
+                      static_cast<uint32_t>(static_cast<unsigned char>(text[i + 2])));
+    }
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    return grams;
+  }
+
+  /**
+   * Returns the Levenshtein distance between `a` and `b`, or any value greater
+   * than `bound` as soon as the distance is known to exceed it.
+   *
+   * Only the cells within `bound` of the diagonal of the usual dynamic
+   * programming table can hold a distance of at most `bound`, so each row
+   * computes just that band: O(bound * |a|) instead of O(|a| * |b|).
+   * `scratch` is reused between calls to avoid allocating.
+   */
+  static size_t bounded_edit_distance(std::string_view a,
+                                      std::string_view b,
+                                      size_t bound,
+                                      std::vector<size_t>& scratch)
+  {
+    // A common prefix or suffix never contributes to the distance
+    while (!a.empty() && !b.empty() && a.front() == b.front()) {
+      a.remove_prefix(1);
+      b.remove_prefix(1);
+    }
+    while (!a.empty() && !b.empty() && a.back() == b.back()) {
+      a.remove_suffix(1);
+      b.remove_suffix(1);
+    }
+
+    const size_t out = bound + 1;
+    scratch.assign(2 * (b.size() + 1), out);
+    size_t* previous = scratch.data();
+    size_t* current = previous + b.size() + 1;
+
+    for (size_t j = 0; j <= std::min(b.size(), bound); ++j)
+      previous[j] = j;
+
+    for (size_t i = 1; i <= a.size(); ++i) {
+      size_t first = i > bound ? i - bound : 1;
+      size_t last = std::min(b.size(), i + bound);
+
+      current[first - 1] = first == 1 && i <= bound ? i : out;
+      size_t row_min = current[first - 1];
+      for (size_t j = first; j <= last; ++j) {
+        size_t substitute = previous[j - 1] + (a[i - 1] != b[j - 1]);
+        current[j] = std::min({ previous[j] + 1, current[j - 1] + 1, substitute, out });
+        row_min = std::min(row_min, current[j]);
+      }
+      if (last < b.size())
+        current[last + 1] = out;
+
+      if (row_min > bound)
+        return out;
+      std::swap(previous, current);
+    }
+    return previous[b.size()];
+  }
+
+  std::vector<std::string> folded;
+  std::vector<uint32_t> sorted_ids;
+  std::unordered_map<uint32_t, std::vector<uint32_t>> postings;
+};
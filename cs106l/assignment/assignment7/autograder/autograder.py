@@ -108,6 +108,15 @@ if __name__ == "__main__":
         ),
     )
 
+    grader.add_part(
+        "Part 1: Custom deleters, arrays, release and reset",
+        lambda: verify_output(
+            "deleters_and_arrays",
+            expected=["4950", "1"],
+            hint="Make sure the deleter is moved along with the pointer, and that release() gives up ownership without deleting anything.",
+        ),
+    )
+
     grader.add_part(
         "Part 2: Linked List",
         lambda: verify_output(
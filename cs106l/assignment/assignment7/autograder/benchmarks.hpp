@@ -0,0 +1,266 @@
+/** Contains benchmarks for the memory diagnostics and the smart pointers in this assignment.
+ * Each benchmark is registered in utils.hpp and can be run with `./<executable> <benchmark name>`.
+ * Compile a separate optimized executable for meaningful numbers (e.g.
+ * `g++ -std=c++20 -O2 main.cpp -o bench`): the autograder's move constructor test destroys
+ * a unique_ptr twice on purpose and is only reliable in the unoptimized build. */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../intrusive_ptr.h"
+#include "diagnostics.hpp"
+
+namespace Benchmarks {
+
+/**
+ * Runs `f` once and reports the total time along with the average time per operation,
+ * where `operations` is the number of operations `f` performs.
+ */
+template <typename Func> void time_func(const std::string& label, Func f, size_t operations) {
+  // Temporarily disable logging (e.g. from the ListNode constructor and destructor)
+  std::cout.setstate(std::ios_base::failbit);
+
+  auto start = std::chrono::steady_clock::now();
+  f();
+  auto end = std::chrono::steady_clock::now();
+
+  // Re-enable logging
+  std::cout.clear();
+
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  std::cout << std::left << std::setw(48) << label << std::right << std::setw(10)
+            << ns / 1000000 << "ms" << std::setw(10) << ns / operations << "ns/op\n";
+}
+
+/**
+ * Hammers the global operator new/delete from 16 threads at once. The surrounding
+ * MemoryGuard fails the run if the tracker loses or double-counts any allocation.
+ */
+void benchmark_tracker_threads() {
+  constexpr size_t kThreads = 16;
+  constexpr size_t kRounds = 2000;
+  constexpr size_t kBatch = 64;
+
+  MemoryDiagnostics::MemoryGuard guard("MemoryTracker lost track of concurrent allocations!");
+  time_func(
+      std::to_string(kThreads) + " threads x new/delete",
+      [] {
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < kThreads; ++t) {
+          threads.emplace_back([] {
+            std::vector<std::string*> live;
+            live.reserve(kBatch);
+            for (size_t round = 0; round < kRounds; ++round) {
+              // Strings longer than the SSO buffer make a second, separately sized allocation
+              for (size_t i = 0; i < kBatch; ++i)
+                live.push_back(new std::string(16 + i, 'x'));
+              for (auto* str : live)
+                delete str;
+              live.clear();
+            }
+          });
+        }
+        for (auto& thread : threads)
+          thread.join();
+      },
+      kThreads * kRounds * kBatch);
+}
+
+/**
+ * Compares the cost of the table-based and header-based trackers (and plain malloc/free
+ * as a baseline) on batches of mixed-size allocations. The trackers are driven
+ * directly rather than through operator new, so all three run in the same binary.
+ */
+void benchmark_tracker_modes() {
+  constexpr size_t kRounds = 20000;
+  constexpr size_t kBatch = 256;
+  std::vector<void*> live(kBatch);
+
+  auto run = [&](const std::string& label, auto allocate, auto deallocate) {
+    time_func(
+        label,
+        [&] {
+          for (size_t round = 0; round < kRounds; ++round) {
+            for (size_t i = 0; i < kBatch; ++i)
+              live[i] = allocate(8 + (i * 24) % 512);
+            for (size_t i = 0; i < kBatch; ++i)
+              deallocate(live[i]);
+          }
+        },
+        kRounds * kBatch);
+  };
+
+  run("malloc/free (baseline)", [](size_t size) { return std::malloc(size); },
+      [](void* ptr) { std::free(ptr); });
+
+  static MemoryDiagnostics::detail::MapTracker map_tracker;
+  run("MapTracker", [](size_t size) { return map_tracker.allocate(size); },
+      [](void* ptr) { map_tracker.deallocate(ptr); });
+
+  static MemoryDiagnostics::detail::HeaderTracker header_tracker;
+  run("HeaderTracker", [](size_t size) { return header_tracker.allocate(size); },
+      [](void* ptr) { header_tracker.deallocate(ptr); });
+
+  // Over-aligned allocations go through the aligned operator new overloads
+  MemoryDiagnostics::MemoryGuard guard("Aligned allocations were not tracked correctly!");
+  struct alignas(64) CacheLine {
+    char bytes[64];
+  };
+  for (size_t i = 0; i < kBatch; ++i) {
+    auto* line = new CacheLine;
+    if (reinterpret_cast<std::uintptr_t>(line) % alignof(CacheLine) != 0) {
+      std::cerr << "operator new(std::align_val_t) returned a misaligned pointer!\n";
+      std::exit(1);
+    }
+    delete line;
+  }
+}
+
+/**
+ * Builds, traverses and destroys a 10M node list, once with one `new` per node and once
+ * with the nodes allocated from a `cs106l::node_pool`.
+ */
+void benchmark_list_pool() {
+  constexpr size_t kNodes = 10000000;
+  std::vector<int> values(kNodes);
+  for (size_t i = 0; i < kNodes; ++i)
+    values[i] = static_cast<int>(i);
+
+  auto run = [&](const std::string& label, auto make_list) {
+    auto head = make_list();
+
+    long long sum = 0;
+    time_func(
+        label + " traverse",
+        [&] { map_list(head, [&](int value) { sum += value; }); },
+        kNodes);
+
+    time_func(
+        label + " destroy",
+        [&] { head = nullptr; },
+        kNodes);
+
+    if (sum != static_cast<long long>(kNodes) * (kNodes - 1) / 2) {
+      std::cerr << label << " traversal visited the wrong nodes!\n";
+      std::exit(1);
+    }
+  };
+
+  {
+    MemoryDiagnostics::MemoryGuard guard("List benchmark leaked memory!");
+    run("new per node", [&] {
+      cs106l::unique_ptr<ListNode<int>> head;
+      time_func("new per node build", [&] { head = create_list(values); }, kNodes);
+      return head;
+    });
+  }
+
+  {
+    MemoryDiagnostics::MemoryGuard guard("Pooled list benchmark leaked memory!");
+    cs106l::node_pool<PooledListNode<int>> pool;
+    run("node_pool", [&] {
+      cs106l::node_pool<PooledListNode<int>>::pointer head;
+      time_func("node_pool build", [&] { head = create_list(pool, values); }, kNodes);
+      return head;
+    });
+  }
+}
+
+/**
+ * Measures steady-state traversal throughput of map_list over a 5M node list, with the
+ * nodes allocated one at a time and from a `cs106l::node_pool`.
+ */
+void benchmark_list_traversal() {
+  constexpr size_t kNodes = 5000000;
+  constexpr size_t kPasses = 20;
+  std::vector<int> values(kNodes, 1);
+
+  auto run = [&](const std::string& label, const auto& head) {
+    long long sum = 0;
+    time_func(
+        label,
+        [&] {
+          for (size_t pass = 0; pass < kPasses; ++pass)
+            map_list(head, [&](int value) { sum += value; });
+        },
+        kNodes * kPasses);
+
+    if (sum != static_cast<long long>(kNodes * kPasses)) {
+      std::cerr << label << " traversal visited the wrong nodes!\n";
+      std::exit(1);
+    }
+  };
+
+  std::cout.setstate(std::ios_base::failbit);
+  auto list = create_list(values);
+  cs106l::node_pool<PooledListNode<int>> pool;
+  auto pooled_list = create_list(pool, values);
+  std::cout.clear();
+
+  run("map_list (new per node)", list);
+  run("map_list (node_pool)", pooled_list);
+
+  // Silence the node destructors while the lists go out of scope
+  std::cout.setstate(std::ios_base::failbit);
+}
+
+/**
+ * Compares the cost of copying and destroying shared pointers: std::shared_ptr against
+ * cs106l::intrusive_ptr with both counting policies on one thread, then the thread-safe
+ * pointers with several threads copying the same object at once.
+ */
+void benchmark_refcount() {
+  constexpr size_t kRounds = 20000;
+  constexpr size_t kBatch = 500;
+  constexpr size_t kThreads = 4;
+
+  auto copy_and_destroy = [](const auto& source) {
+    std::vector<std::remove_cvref_t<decltype(source)>> copies(kBatch);
+    for (size_t round = 0; round < kRounds; ++round) {
+      for (auto& copy : copies)
+        copy = source;
+      for (auto& copy : copies)
+        copy = nullptr;
+    }
+  };
+
+  auto run = [&](const std::string& label, const auto& source, size_t threads) {
+    time_func(
+        label + ", " + std::to_string(threads) + " thread(s)",
+        [&] {
+          std::vector<std::thread> workers;
+          for (size_t t = 0; t < threads; ++t)
+            workers.emplace_back([&] { copy_and_destroy(source); });
+          for (auto& worker : workers)
+            worker.join();
+        },
+        threads * kRounds * kBatch);
+  };
+
+  MemoryDiagnostics::MemoryGuard guard("Shared pointer benchmark leaked memory!");
+  auto shared = std::make_shared<std::string>("shared");
+  auto intrusive = cs106l::make_intrusive<std::string>("shared");
+  auto local = cs106l::make_intrusive<std::string, cs106l::local_refcount>("shared");
+
+  run("std::shared_ptr", shared, 1);
+  run("intrusive_ptr<atomic_refcount>", intrusive, 1);
+  run("intrusive_ptr<local_refcount>", local, 1);
+  run("std::shared_ptr", shared, kThreads);
+  run("intrusive_ptr<atomic_refcount>", intrusive, kThreads);
+
+  if (shared.use_count() != 1 || intrusive.use_count() != 1 || local.use_count() != 1) {
+    std::cerr << "Reference counts did not return to 1!\n";
+    std::exit(1);
+  }
+}
+
+} // namespace Benchmarks
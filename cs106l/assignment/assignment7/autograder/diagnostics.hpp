@@ -2,18 +2,33 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
 #include <limits>
+#include <mutex>
 #include <new>
+#include <thread>
 #include <unordered_map>
+#include <vector>
+
+#ifdef MEMORY_DIAGNOSTICS_LEAK_REPORT
+#ifdef MEMORY_DIAGNOSTICS_HEADER_TRACKING
+#error "MEMORY_DIAGNOSTICS_LEAK_REPORT requires the allocation table and cannot be combined with MEMORY_DIAGNOSTICS_HEADER_TRACKING"
+#endif
+#include <algorithm>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#endif
 
 namespace MemoryDiagnostics {
 namespace detail {
 
 /**
- * In order to initialize an unordered_map inside of the MemoryTracker class below,
+ * In order to initialize an unordered_map inside of the MapTracker class below,
  * we must make dynamic allocations. However, the default allocator for unordered_map
  * calls operator new and delete, which would cause infinite recursion. To avoid this,
  * we define a custom allocator that uses std::malloc and std::free instead and define
@@ -50,38 +65,299 @@ template <class T, class U> bool operator!=(const Mallocator<T>&, const Mallocat
   return false;
 }
 
-class MemoryTracker {
-  using AllocationsMap = std::unordered_map<void*, size_t, std::hash<void*>, std::equal_to<void*>,
-                                            Mallocator<std::pair<void* const, size_t>>>;
-  size_t bytes_outstanding = 0;
-  AllocationsMap allocations;
+/**
+ * A minimal spin lock guarding a single MemoryTracker shard. Critical sections are a
+ * single hash map operation, so spinning (and yielding under contention) is cheaper
+ * than parking the thread. Unlike some std::mutex implementations, it never allocates,
+ * which matters because it is taken from inside operator new.
+ */
+class SpinLock {
+  std::atomic_flag flag = ATOMIC_FLAG_INIT;
 
 public:
-  void* allocate(size_t size) {
+  void lock() noexcept {
+    while (flag.test_and_set(std::memory_order_acquire))
+      std::this_thread::yield();
+  }
+
+  void unlock() noexcept { flag.clear(std::memory_order_release); }
+};
+
+/** The alignment every plain (non-aligned) operator new must honor. */
+static constexpr size_t kDefaultAlignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+/**
+ * Allocates `size` bytes aligned to `alignment` straight from the C allocator, so that
+ * the result can always be released with std::free.
+ */
+void* allocate_block(size_t size, size_t alignment) {
+  void* ptr;
+  if (alignment <= kDefaultAlignment) {
+    ptr = std::malloc(size);
+  } else {
+    // std::aligned_alloc requires the size to be a multiple of the alignment
+    ptr = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+  }
+
+  if (ptr == nullptr)
+    throw std::bad_alloc{}; // required by [new.delete.single]/3
+  return ptr;
+}
+
+/**
+ * Tracks every live allocation in a hash table so that MemoryGuard can compare
+ * outstanding bytes.
+ *
+ * The allocation table is split into independent shards selected by the pointer's
+ * address, so threads allocating concurrently rarely touch the same lock, and the
+ * outstanding byte count is a single atomic counter that never needs a lock at all.
+ * This keeps the global operator new/delete below safe to use from multithreaded tests.
+ */
+class MapTracker {
+  static constexpr size_t kNumShards = 64;
+
+#ifdef MEMORY_DIAGNOSTICS_LEAK_REPORT
+  static constexpr int kMaxFrames = 16;
+  static constexpr int kSkippedFrames = 2; // MapTracker::allocate and operator new
+  static constexpr size_t kMaxReportedLeaks = 20;
+#endif
+
+  struct AllocationRecord {
+    size_t size;
+#ifdef MEMORY_DIAGNOSTICS_LEAK_REPORT
+    size_t sequence;
+    int depth;
+    void* frames[kMaxFrames];
+#endif
+  };
+
+  using AllocationsMap =
+      std::unordered_map<void*, AllocationRecord, std::hash<void*>, std::equal_to<void*>,
+                         Mallocator<std::pair<void* const, AllocationRecord>>>;
+
+  struct alignas(64) Shard {
+    SpinLock lock;
+    AllocationsMap allocations;
+  };
+
+  alignas(64) std::atomic<size_t> bytes_outstanding = 0;
+#ifdef MEMORY_DIAGNOSTICS_LEAK_REPORT
+  std::atomic<size_t> peak_bytes_outstanding = 0;
+  std::atomic<size_t> next_sequence = 0;
+#endif
+  Shard shards[kNumShards];
+
+  Shard& shard_for(void* ptr) {
+    // malloc'd addresses are 16-byte aligned, so mix the higher bits into the index
+    auto bits = reinterpret_cast<std::uintptr_t>(ptr) >> 4;
+    bits ^= bits >> 7 ^ bits >> 17;
+    return shards[bits % kNumShards];
+  }
+
+#ifdef MEMORY_DIAGNOSTICS_LEAK_REPORT
+  /**
+   * Prints a single stack frame as `function (module+offset)`. Functions internal to the
+   * executable only resolve to a name when linking with -rdynamic; otherwise the module
+   * offset can be passed to `addr2line -e <module>`.
+   */
+  static void print_frame(std::ostream& os, void* frame) {
+    Dl_info info;
+    if (dladdr(frame, &info) == 0 || info.dli_fname == nullptr) {
+      os << frame;
+      return;
+    }
+
+    if (info.dli_sname) {
+      int status = 0;
+      char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+      os << (status == 0 ? demangled : info.dli_sname) << " ";
+      std::free(demangled);
+    }
+
+    auto offset = static_cast<char*>(frame) - static_cast<char*>(info.dli_fbase);
+    os << "(" << info.dli_fname << "+0x" << std::hex << offset << std::dec << ")";
+  }
+#endif
+
+public:
+#ifdef MEMORY_DIAGNOSTICS_LEAK_REPORT
+  MapTracker() {
+    // The first call to backtrace() loads the unwinder, which allocates; do it up front
+    void* frame;
+    backtrace(&frame, 1);
+  }
+#endif
+
+  void* allocate(size_t size, size_t alignment = kDefaultAlignment) {
     if (size == 0)
       ++size; // avoid std::malloc(0) which may return nullptr on success
 
-    void* ptr = std::malloc(size);
-    if (ptr == nullptr)
-      throw std::bad_alloc{}; // required by [new.delete.single]/3
+    void* ptr = allocate_block(size, alignment);
+
+    AllocationRecord record{size};
+#ifdef MEMORY_DIAGNOSTICS_LEAK_REPORT
+    record.sequence = next_sequence.fetch_add(1, std::memory_order_relaxed);
+    record.depth = backtrace(record.frames, kMaxFrames);
+#endif
 
-    bytes_outstanding += size;
-    allocations[ptr] = size;
+    auto& shard = shard_for(ptr);
+    {
+      std::lock_guard<SpinLock> lock(shard.lock);
+      shard.allocations[ptr] = record;
+    }
+    [[maybe_unused]] size_t outstanding = bytes_outstanding.fetch_add(size, std::memory_order_relaxed) + size;
+#ifdef MEMORY_DIAGNOSTICS_LEAK_REPORT
+    size_t peak = peak_bytes_outstanding.load(std::memory_order_relaxed);
+    while (outstanding > peak &&
+           !peak_bytes_outstanding.compare_exchange_weak(peak, outstanding,
+                                                         std::memory_order_relaxed)) {
+    }
+#endif
     return ptr;
   }
 
   void deallocate(void* ptr) {
+    if (ptr == nullptr)
+      return;
+
+    // Erase before freeing: once the block is returned to malloc, another thread may
+    // receive the same address and insert it into this shard.
+    size_t size = 0;
+    auto& shard = shard_for(ptr);
+    {
+      std::lock_guard<SpinLock> lock(shard.lock);
+      auto it = shard.allocations.find(ptr);
+      if (it != shard.allocations.end()) {
+        size = it->second.size;
+        shard.allocations.erase(it);
+      }
+    }
     std::free(ptr);
-    auto it = allocations.find(ptr);
-    if (it != allocations.end()) {
-      bytes_outstanding -= it->second;
-      allocations.erase(it);
+    bytes_outstanding.fetch_sub(size, std::memory_order_relaxed);
+  }
+
+  size_t get_bytes_outstanding() const { return bytes_outstanding.load(std::memory_order_relaxed); }
+
+#ifdef MEMORY_DIAGNOSTICS_LEAK_REPORT
+  /** Returns the highest number of bytes that were ever outstanding at once. */
+  size_t get_peak_bytes_outstanding() const {
+    return peak_bytes_outstanding.load(std::memory_order_relaxed);
+  }
+
+  /** Returns the sequence number that the next allocation will receive. */
+  size_t get_sequence() const { return next_sequence.load(std::memory_order_relaxed); }
+
+  /**
+   * Lists every block that is still live and was allocated at or after sequence number
+   * `since`, oldest first, with its size and the call stack that allocated it.
+   */
+  void report_leaks(size_t since, std::ostream& os) {
+    using Leak = std::pair<void*, AllocationRecord>;
+    std::vector<Leak, Mallocator<Leak>> leaks;
+
+    // Collect with Mallocator: calling operator new here would re-enter the shard locks
+    for (auto& shard : shards) {
+      std::lock_guard<SpinLock> lock(shard.lock);
+      for (const auto& [ptr, record] : shard.allocations) {
+        if (record.sequence >= since)
+          leaks.emplace_back(ptr, record);
+      }
+    }
+
+    std::sort(leaks.begin(), leaks.end(), [](const Leak& a, const Leak& b) {
+      return a.second.sequence < b.second.sequence;
+    });
+
+    size_t leaked_bytes = 0;
+    for (const auto& leak : leaks)
+      leaked_bytes += leak.second.size;
+
+    os << "Leaked " << leaks.size() << " block(s) totalling " << leaked_bytes
+       << " bytes (peak outstanding: " << get_peak_bytes_outstanding() << " bytes)\n";
+
+    for (size_t i = 0; i < leaks.size() && i < kMaxReportedLeaks; ++i) {
+      const auto& [ptr, record] = leaks[i];
+      os << "  allocation #" << record.sequence << ": " << record.size << " bytes at " << ptr
+         << "\n";
+      for (int frame = kSkippedFrames; frame < record.depth; ++frame) {
+        os << "      at ";
+        print_frame(os, record.frames[frame]);
+        os << "\n";
+      }
     }
+
+    if (leaks.size() > kMaxReportedLeaks)
+      os << "  ... and " << leaks.size() - kMaxReportedLeaks << " more\n";
+  }
+#endif
+};
+
+/**
+ * Tracks allocations by storing each block's size in a small header placed directly
+ * before the pointer handed back to the caller. Allocation and deallocation are O(1)
+ * with no table lookup and no extra allocation, at the cost of `alignment` extra bytes
+ * per block.
+ *
+ * Memory layout of a block (the header always fits, since alignment >= 16 bytes):
+ *
+ *   base                                 ptr (returned, aligned)
+ *   |  padding ...  | BlockHeader        | size bytes ...
+ *   |<-------- alignment bytes --------->|
+ */
+class HeaderTracker {
+  struct BlockHeader {
+    size_t size;   // requested size in bytes
+    size_t offset; // distance from the start of the underlying malloc block
+  };
+
+  static_assert(sizeof(BlockHeader) <= kDefaultAlignment);
+
+  alignas(64) std::atomic<size_t> bytes_outstanding = 0;
+
+  static BlockHeader* header_of(void* ptr) { return static_cast<BlockHeader*>(ptr) - 1; }
+
+public:
+  void* allocate(size_t size, size_t alignment = kDefaultAlignment) {
+    if (size == 0)
+      ++size;
+    if (alignment < kDefaultAlignment)
+      alignment = kDefaultAlignment;
+    if (size > std::numeric_limits<size_t>::max() - alignment)
+      throw std::bad_alloc{};
+
+    auto* base = static_cast<char*>(allocate_block(size + alignment, alignment));
+    void* ptr = base + alignment;
+    *header_of(ptr) = {size, alignment};
+
+    bytes_outstanding.fetch_add(size, std::memory_order_relaxed);
+    return ptr;
   }
 
-  size_t get_bytes_outstanding() const { return bytes_outstanding; }
+  void deallocate(void* ptr) {
+    if (ptr == nullptr)
+      return;
+
+    BlockHeader header = *header_of(ptr);
+    std::free(static_cast<char*>(ptr) - header.offset);
+    bytes_outstanding.fetch_sub(header.size, std::memory_order_relaxed);
+  }
+
+  size_t get_bytes_outstanding() const { return bytes_outstanding.load(std::memory_order_relaxed); }
 };
 
+/**
+ * The tracker used by the global operator new/delete. Compile with
+ * -DMEMORY_DIAGNOSTICS_HEADER_TRACKING to store sizes in block headers instead of the
+ * allocation table, or with -DMEMORY_DIAGNOSTICS_LEAK_REPORT (and ideally -rdynamic) to
+ * record a sequence number and call stack for every allocation, so that a failing
+ * MemoryGuard lists what leaked and where.
+ */
+#ifdef MEMORY_DIAGNOSTICS_HEADER_TRACKING
+using MemoryTracker = HeaderTracker;
+#else
+using MemoryTracker = MapTracker;
+#endif
+
 MemoryTracker& get_tracker() {
   static MemoryTracker tracker;
   return tracker;
@@ -93,18 +369,27 @@ MemoryTracker& get_tracker() {
  * MemoryGuard makes sure that the dynamic allocation count at construction
  * matches the count at destruction. If the counts do not match, MemoryGuard
  * will print an error message to stderr and exit the program with a predefined
- * exit code.
+ * exit code. In leak report mode, it also lists the blocks allocated during its
+ * lifetime that were never freed.
  */
 class MemoryGuard {
 public:
   MemoryGuard(const char* message)
-      : message(message), initial_bytes_outstanding(detail::get_tracker().get_bytes_outstanding()) {
+      : message(message), initial_bytes_outstanding(detail::get_tracker().get_bytes_outstanding())
+#ifdef MEMORY_DIAGNOSTICS_LEAK_REPORT
+        ,
+        initial_sequence(detail::get_tracker().get_sequence())
+#endif
+  {
   }
 
   ~MemoryGuard() {
     if (initial_bytes_outstanding != detail::get_tracker().get_bytes_outstanding()) {
       if (message)
         std::cerr << message << std::endl;
+#ifdef MEMORY_DIAGNOSTICS_LEAK_REPORT
+      detail::get_tracker().report_leaks(initial_sequence, std::cerr);
+#endif
       std::exit(exit_code);
     }
   }
@@ -114,6 +399,9 @@ public:
 private:
   const char* message = nullptr;
   size_t initial_bytes_outstanding;
+#ifdef MEMORY_DIAGNOSTICS_LEAK_REPORT
+  size_t initial_sequence;
+#endif
   static constexpr const int exit_code = 106;
 };
 
@@ -139,4 +427,28 @@ void operator delete[](void* ptr) noexcept {
 
 void operator delete[](void* ptr, std::size_t size) noexcept {
   MemoryDiagnostics::detail::get_tracker().deallocate(ptr);
+}
+
+void* operator new(std::size_t sz, std::align_val_t al) {
+  return MemoryDiagnostics::detail::get_tracker().allocate(sz, static_cast<std::size_t>(al));
+}
+
+void* operator new[](std::size_t sz, std::align_val_t al) {
+  return MemoryDiagnostics::detail::get_tracker().allocate(sz, static_cast<std::size_t>(al));
+}
+
+void operator delete(void* ptr, std::align_val_t al) noexcept {
+  MemoryDiagnostics::detail::get_tracker().deallocate(ptr);
+}
+
+void operator delete(void* ptr, std::size_t size, std::align_val_t al) noexcept {
+  MemoryDiagnostics::detail::get_tracker().deallocate(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t al) noexcept {
+  MemoryDiagnostics::detail::get_tracker().deallocate(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t size, std::align_val_t al) noexcept {
+  MemoryDiagnostics::detail::get_tracker().deallocate(ptr);
 }
\ No newline at end of file
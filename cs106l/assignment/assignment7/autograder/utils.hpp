@@ -3,6 +3,7 @@
  * (unless you are really curious and want to!)                              *
  * ========================================================================= */
 
+#include "benchmarks.hpp"
 #include "diagnostics.hpp"
 
 static const std::string kReallyLongString =
@@ -156,6 +157,52 @@ template <typename UniquePtr> void test_copy() {
   }
 }
 
+/* A unique_ptr with a stateless deleter should be exactly as large as a raw pointer */
+static_assert(sizeof(cs106l::unique_ptr<std::string>) == sizeof(std::string*));
+static_assert(sizeof(cs106l::unique_ptr<int[]>) == sizeof(int*));
+static_assert(sizeof(cs106l::node_pool<PooledListNode<int>>::pointer) == sizeof(void*));
+
+void test_deleters_and_arrays() {
+  MemoryDiagnostics::MemoryGuard guard(
+      "Failed to deallocate memory in unique_ptr with a custom deleter, an array, release() or "
+      "reset()!");
+
+  auto array = cs106l::make_unique<int[]>(100);
+  for (size_t i = 0; i < 100; ++i)
+    array[i] = i;
+  int sum = 0;
+  for (size_t i = 0; i < 100; ++i)
+    sum += array[i];
+
+  size_t deletions = 0;
+  {
+    auto counting_delete = [&deletions](std::string* ptr) {
+      ++deletions;
+      delete ptr;
+    };
+    cs106l::unique_ptr<std::string, decltype(counting_delete)> ptr(new std::string("hello"),
+                                                                   counting_delete);
+    auto other = std::move(ptr);
+  }
+
+  auto ptr = cs106l::make_unique<std::string>(kReallyLongString);
+  std::string* raw = ptr.release();
+  if (ptr || raw == nullptr) {
+    std::cerr << "release() should return the managed pointer and leave the unique_ptr empty!\n";
+    std::exit(1);
+  }
+  delete raw;
+
+  ptr.reset(new std::string(kReallyLongString));
+  ptr.reset();
+  if (ptr) {
+    std::cerr << "reset() should leave the unique_ptr empty!\n";
+    std::exit(1);
+  }
+
+  std::cout << sum << "\n" << deletions << "\n";
+}
+
 const std::unordered_map<std::string, std::function<void()>> test_functions = {
     {"memory_leak_exit_code",
      []() { std::cout << MemoryDiagnostics::MemoryGuard::get_exit_code() << "\n"; }},
@@ -165,6 +212,12 @@ const std::unordered_map<std::string, std::function<void()>> test_functions = {
     {"move_assignment", test_move_assignment},
     {"move_self_assignment", test_move_self_assignment},
     {"linked_list", test_linked_list_example},
+    {"deleters_and_arrays", test_deleters_and_arrays},
+    {"benchmark_tracker_threads", Benchmarks::benchmark_tracker_threads},
+    {"benchmark_tracker_modes", Benchmarks::benchmark_tracker_modes},
+    {"benchmark_list_pool", Benchmarks::benchmark_list_pool},
+    {"benchmark_list_traversal", Benchmarks::benchmark_list_traversal},
+    {"benchmark_refcount", Benchmarks::benchmark_refcount},
 };
 
 int run_autograder() {
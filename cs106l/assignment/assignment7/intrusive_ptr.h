@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace cs106l {
+
+/**
+ * @brief A reference count that is safe to share between threads.
+ * @note Increments only need to be atomic; the decrement that drops the count to zero
+ * must also see every write made through other references, hence acquire-release.
+ */
+struct atomic_refcount {
+  std::atomic<size_t> count = 1;
+
+  void increment() { count.fetch_add(1, std::memory_order_relaxed); }
+
+  /** @return `true` if this was the last reference. */
+  bool decrement() { return count.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+
+  size_t get() const { return count.load(std::memory_order_relaxed); }
+};
+
+/**
+ * @brief A plain reference count for objects that never leave a single thread.
+ */
+struct local_refcount {
+  size_t count = 1;
+
+  void increment() { ++count; }
+
+  /** @return `true` if this was the last reference. */
+  bool decrement() { return --count == 0; }
+
+  size_t get() const { return count; }
+};
+
+template <typename T, typename RefCount> class intrusive_ptr;
+
+template <typename T, typename RefCount = atomic_refcount, typename... Args>
+intrusive_ptr<T, RefCount> make_intrusive(Args&&... args);
+
+/**
+ * @brief A smart pointer that shares ownership of an object through a reference count.
+ *
+ * Unlike `std::shared_ptr`, the reference count is stored intrusively, right next to the
+ * object in a single allocation made by `make_intrusive()`. An `intrusive_ptr` is
+ * therefore a single pointer, and copying one touches only the cache line that holds
+ * the object.
+ *
+ * @tparam T The type of the object to manage.
+ * @tparam RefCount The counting policy: `atomic_refcount` (the default) if copies of the
+ *                  pointer may be used from several threads, or `local_refcount` if not.
+ */
+template <typename T, typename RefCount = atomic_refcount> class intrusive_ptr {
+private:
+  struct block {
+    RefCount refs;
+    T value;
+
+    template <typename... Args> block(Args&&... args) : value(std::forward<Args>(args)...) {}
+  };
+
+  block* ptr;
+
+  explicit intrusive_ptr(block* ptr) : ptr(ptr) {}
+
+  template <typename U, typename R, typename... Args>
+  friend intrusive_ptr<U, R> make_intrusive(Args&&... args);
+
+public:
+  /**
+   * @brief Constructs an empty `intrusive_ptr`.
+   */
+  intrusive_ptr() : ptr(nullptr) {}
+  intrusive_ptr(std::nullptr_t) : ptr(nullptr) {}
+
+  /**
+   * @brief Shares ownership of the object managed by `other`.
+   */
+  intrusive_ptr(const intrusive_ptr& other) : ptr(other.ptr) {
+    if (ptr)
+      ptr->refs.increment();
+  }
+
+  intrusive_ptr(intrusive_ptr&& other) : ptr(std::exchange(other.ptr, nullptr)) {}
+
+  intrusive_ptr& operator=(intrusive_ptr other) {
+    std::swap(ptr, other.ptr);
+    return *this;
+  }
+
+  /**
+   * @brief Releases this reference, destroying the object if it was the last one.
+   */
+  ~intrusive_ptr() {
+    if (ptr && ptr->refs.decrement())
+      delete ptr;
+  }
+
+  T& operator*() const { return ptr->value; }
+  T* operator->() const { return &ptr->value; }
+  T* get() const { return ptr ? &ptr->value : nullptr; }
+
+  /** @return The number of `intrusive_ptr`s sharing the object, or 0 if empty. */
+  size_t use_count() const { return ptr ? ptr->refs.get() : 0; }
+
+  operator bool() const { return ptr != nullptr; }
+};
+
+/**
+ * @brief Creates a new object shared through an `intrusive_ptr`, allocating the object
+ * and its reference count together.
+ * @example auto dictionary = make_intrusive<std::set<std::string>>();
+ * @tparam T The type of object to create.
+ * @tparam RefCount The counting policy (see `intrusive_ptr`).
+ * @param args The arguments to pass to the constructor of T.
+ */
+template <typename T, typename RefCount, typename... Args>
+intrusive_ptr<T, RefCount> make_intrusive(Args&&... args) {
+  using block = typename intrusive_ptr<T, RefCount>::block;
+  return intrusive_ptr<T, RefCount>(new block(std::forward<Args>(args)...));
+}
+
+}
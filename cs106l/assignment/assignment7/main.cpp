@@ -9,22 +9,26 @@
 #include <unordered_map>
 #include <vector>
 
+#include "node_pool.h"
 #include "unique_ptr.h"
 
 /**
  * @brief A singly-linked list node that deallocates itself automatically
  * by using a `unique_ptr` to manage the pointer to the next node.
  * @tparam T The type of the value stored in the node.
+ * @tparam Deleter The deleter template used by `next`. Lists whose nodes live in a
+ *                 `cs106l::node_pool` use `cs106l::pool_delete` (see `PooledListNode`).
  *
  * @note No modifications are necessary to this struct in order to complete the assignment!
  */
-template <typename T> struct ListNode {
+template <typename T, template <typename> class Deleter = cs106l::default_delete>
+struct ListNode {
 
   /** @brief The value stored inside this node. */
   T value;
 
   /** @brief The smart pointer to the next node. May be null. */
-  cs106l::unique_ptr<ListNode<T>> next;
+  cs106l::unique_ptr<ListNode, Deleter<ListNode>> next;
 
   /**
    * @brief Constructs a single element linked list, setting `next` to `nullptr`.
@@ -42,17 +46,54 @@ template <typename T> struct ListNode {
      * destructor runs!
      */
     std::cout << "Destructing node with value '" << value << "'\n";
+
+    /* Letting `next` go out of scope would destroy the rest of the list recursively,
+     * one stack frame per node. Instead, unlink the successors one at a time: each
+     * node is destroyed after its own `next` has been moved out, so it has nothing
+     * left to destroy.
+     */
+    while (next)
+      next = std::move(next->next);
   }
 };
 
+/** @brief A list node allocated from a `cs106l::node_pool`. */
+template <typename T> using PooledListNode = ListNode<T, cs106l::pool_delete>;
+
 /**
  * @brief Creates a singly-linked list from a vector of values.
  * @param values The values to store in the list.
  * @return A `unique_ptr` to the head of the list.
  */
 template <typename T> cs106l::unique_ptr<ListNode<T>> create_list(const std::vector<T>& values) {
-  /* STUDENT TODO: Implement this method */
-  throw std::runtime_error("Not implemented: createList");
+  cs106l::unique_ptr<ListNode<T>> head = nullptr;
+  for (int i = static_cast<int>(values.size()) - 1; i >= 0; --i) {
+    auto node = cs106l::make_unique<ListNode<T>>(values[i]);
+    node->next = std::move(head);
+    head = std::move(node);
+  }
+  return head;
+}
+
+/**
+ * @brief Creates a singly-linked list from a vector of values, allocating its nodes
+ * contiguously from `pool` instead of with one `new` per node.
+ * @param pool The pool to allocate nodes from. Must outlive the returned list.
+ * @param values The values to store in the list.
+ * @return A `unique_ptr` to the head of the list.
+ */
+template <typename T>
+typename cs106l::node_pool<PooledListNode<T>>::pointer
+create_list(cs106l::node_pool<PooledListNode<T>>& pool, const std::vector<T>& values) {
+  typename cs106l::node_pool<PooledListNode<T>>::pointer head = nullptr;
+
+  // Build front to back so that the nodes are laid out in the pool in traversal order
+  auto* tail = &head;
+  for (const auto& value : values) {
+    *tail = pool.make_unique(value);
+    tail = &(*tail)->next;
+  }
+  return head;
 }
 
 /**
@@ -61,13 +102,14 @@ template <typename T> cs106l::unique_ptr<ListNode<T>> create_list(const std::vec
  * @tparam Func The type of the function to apply.
  * @param head The head of the linked list.
  * @paragraph func The function to apply to each element.
+ * @note This walks the list with a loop rather than recursion, so it uses constant stack
+ * space no matter how long the list is.
  */
-template <typename T, typename Func>
-void map_list(const cs106l::unique_ptr<ListNode<T>>& head, const Func& func) {
-  if (!head)
-    return;
-  func(head->value);
-  map_list(head->next, func);
+template <typename T, template <typename> class Deleter, typename Func>
+void map_list(const cs106l::unique_ptr<ListNode<T, Deleter>, Deleter<ListNode<T, Deleter>>>& head,
+              const Func& func) {
+  for (auto* node = head.get(); node; node = node->next.get())
+    func(node->value);
 }
 
 /**
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "unique_ptr.h"
+
+namespace cs106l {
+
+/**
+ * @brief A deleter for objects created by a `node_pool`. It only runs the object's
+ * destructor: the memory itself belongs to the pool and is released all at once when
+ * the pool is destroyed.
+ * @tparam T The type of the object to destroy.
+ */
+template <typename T> struct pool_delete {
+  void operator()(T* ptr) const { ptr->~T(); }
+};
+
+/**
+ * @brief A slab allocator that hands out objects of a single type as `unique_ptr`s.
+ *
+ * Objects are constructed back to back inside large slabs, so nodes created one after
+ * another sit contiguously in memory and each allocation is just a pointer bump. The
+ * slabs are freed in bulk when the pool is destroyed, so the pool must outlive every
+ * `unique_ptr` it creates.
+ *
+ * @tparam T The type of object to allocate.
+ * @tparam SlabSize The number of objects in each slab.
+ */
+template <typename T, size_t SlabSize = 4096> class node_pool {
+private:
+  struct alignas(T) slot {
+    unsigned char bytes[sizeof(T)];
+  };
+
+  std::vector<slot*> slabs;
+  size_t used = SlabSize; // number of slots used in slabs.back()
+
+public:
+  /** @brief The `unique_ptr` type returned by this pool. */
+  using pointer = unique_ptr<T, pool_delete<T>>;
+
+  node_pool() = default;
+  node_pool(const node_pool& other) = delete;
+  node_pool& operator=(const node_pool& other) = delete;
+
+  ~node_pool() {
+    for (slot* slab : slabs)
+      delete[] slab;
+  }
+
+  /**
+   * @brief Constructs a new object inside the pool.
+   * @param args The arguments to pass to the constructor of T.
+   * @return A `unique_ptr` that destroys (but does not free) the object.
+   */
+  template <typename... Args> pointer make_unique(Args&&... args) {
+    if (used == SlabSize) {
+      slabs.push_back(new slot[SlabSize]);
+      used = 0;
+    }
+
+    T* object = new (slabs.back()[used].bytes) T(std::forward<Args>(args)...);
+    ++used;
+    return pointer(object);
+  }
+};
+
+}
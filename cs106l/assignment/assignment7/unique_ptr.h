@@ -1,18 +1,145 @@
 #pragma once
 
 #include <cstddef>
+#include <type_traits>
 #include <utility>
 
 namespace cs106l {
 
+/**
+ * @brief The default deleter used by `unique_ptr`, which frees the object with `delete`.
+ * @tparam T The type of the object to delete.
+ */
+template <typename T> struct default_delete {
+  void operator()(T* ptr) const { delete ptr; }
+};
+
+/**
+ * @brief The default deleter for `unique_ptr<T[]>`, which frees the array with `delete[]`.
+ * @tparam T The type of the array elements.
+ */
+template <typename T> struct default_delete<T[]> {
+  void operator()(T* ptr) const { delete[] ptr; }
+};
+
+namespace detail {
+
+/**
+ * @brief Stores a pointer together with its deleter.
+ *
+ * When the deleter has no state (like `default_delete`), it is stored as an empty base
+ * class instead of a member. The empty-base optimization lets it occupy no space at all,
+ * so the storage (and therefore a `unique_ptr`) is exactly as large as a raw pointer.
+ */
+template <typename T, typename Deleter,
+          bool = std::is_empty_v<Deleter> && !std::is_final_v<Deleter>>
+class pointer_storage : private Deleter {
+public:
+  T* ptr;
+
+  pointer_storage(T* ptr, Deleter deleter) : Deleter(std::move(deleter)), ptr(ptr) {}
+
+  Deleter& deleter() { return *this; }
+  const Deleter& deleter() const { return *this; }
+};
+
+template <typename T, typename Deleter> class pointer_storage<T, Deleter, false> {
+public:
+  T* ptr;
+  Deleter del;
+
+  pointer_storage(T* ptr, Deleter deleter) : ptr(ptr), del(std::move(deleter)) {}
+
+  Deleter& deleter() { return del; }
+  const Deleter& deleter() const { return del; }
+};
+
+/**
+ * @brief The ownership logic shared by `unique_ptr<T>` and `unique_ptr<T[]>`.
+ * @tparam T The type that the managed pointer points to.
+ * @tparam Deleter A function object called with the pointer to dispose of it.
+ */
+template <typename T, typename Deleter> class unique_ptr_base {
+private:
+  pointer_storage<T, Deleter> storage;
+
+public:
+  unique_ptr_base(T* ptr, Deleter deleter = Deleter()) : storage(ptr, std::move(deleter)) {}
+
+  ~unique_ptr_base() {
+    if (storage.ptr)
+      storage.deleter()(storage.ptr);
+  }
+
+  unique_ptr_base(const unique_ptr_base& other) = delete;
+  unique_ptr_base& operator=(const unique_ptr_base& other) = delete;
+
+  unique_ptr_base(unique_ptr_base&& other)
+      : storage(other.storage.ptr, std::move(other.storage.deleter())) {
+    other.storage.ptr = nullptr;
+  }
+
+  unique_ptr_base& operator=(unique_ptr_base&& other) {
+    if (this == &other)
+      return *this;
+
+    /* Take everything out of `other` before destroying our old object, since the old
+     * object may be the one that owns `other` (e.g. `head = std::move(head->next)`).
+     */
+    Deleter old_deleter = std::exchange(storage.deleter(), std::move(other.storage.deleter()));
+    T* old = std::exchange(storage.ptr, other.release());
+    if (old)
+      old_deleter(old);
+    return *this;
+  }
+
+  /**
+   * @brief Returns the managed pointer without giving up ownership of it.
+   * @return The managed pointer, or `nullptr` if the `unique_ptr` is empty.
+   */
+  T* get() const { return storage.ptr; }
+
+  /** @brief Returns the deleter used to dispose of the managed pointer. */
+  Deleter& get_deleter() { return storage.deleter(); }
+  const Deleter& get_deleter() const { return storage.deleter(); }
+
+  /**
+   * @brief Gives up ownership of the managed pointer without deleting it.
+   * @return The previously managed pointer. The caller is now responsible for it.
+   */
+  T* release() { return std::exchange(storage.ptr, nullptr); }
+
+  /**
+   * @brief Deletes the managed object, if any, and takes ownership of `ptr` instead.
+   * @param ptr The new pointer to manage. Defaults to `nullptr`.
+   */
+  void reset(T* ptr = nullptr) {
+    T* old = std::exchange(storage.ptr, ptr);
+    if (old)
+      storage.deleter()(old);
+  }
+
+  /**
+   * @brief Returns whether or not the `unique_ptr` is non-null.
+   * @note This allows us to use a `unique_ptr` inside an if-statement.
+   * @return `true` if the `unique_ptr` is non-null, `false` otherwise.
+   */
+  operator bool() const { return storage.ptr != nullptr; }
+};
+
+} // namespace detail
+
 /**
  * @brief A smart pointer that owns an object and deletes it when it goes out of scope.
  * @tparam T The type of the object to manage.
+ * @tparam Deleter A function object called with the pointer to dispose of the object.
+ *                 Defaults to calling `delete`. Stateless deleters take up no space.
  * @note This class is a simpler version of `std::unique_ptr`.
  */
-template <typename T> class unique_ptr {
+template <typename T, typename Deleter = default_delete<T>>
+class unique_ptr : public detail::unique_ptr_base<T, Deleter> {
 private:
-  /* STUDENT TODO: What data must a unique_ptr keep track of? */
+  using base = detail::unique_ptr_base<T, Deleter>;
 
 public:
   /**
@@ -20,18 +147,19 @@ public:
    * @param ptr The pointer to manage.
    * @note You should avoid using this constructor directly and instead use `make_unique()`.
    */
-  unique_ptr(T* ptr) {
-    /* STUDENT TODO: Implement the constructor */
-    throw std::runtime_error("Not implemented: unique_ptr(T* ptr)");
-  }
+  unique_ptr(T* ptr) : base(ptr) {}
+
+  /**
+   * @brief Constructs a new `unique_ptr` from the given pointer and deleter.
+   * @param ptr The pointer to manage.
+   * @param deleter The deleter used to dispose of `ptr`.
+   */
+  unique_ptr(T* ptr, Deleter deleter) : base(ptr, std::move(deleter)) {}
 
   /**
    * @brief Constructs a new `unique_ptr` from `nullptr`.
    */
-  unique_ptr(std::nullptr_t) {
-    /* STUDENT TODO: Implement the nullptr constructor */
-    throw std::runtime_error("Not implemented: unique_ptr(std::nullptr_t)");
-  }
+  unique_ptr(std::nullptr_t) : base(nullptr) {}
 
   /**
    * @brief Constructs an empty `unique_ptr`.
@@ -43,57 +171,51 @@ public:
    * @brief Dereferences a `unique_ptr` and returns a reference to the object.
    * @return A reference to the object.
    */
-  T& operator*() {
-    /* STUDENT TODO: Implement the dereference operator */
-    throw std::runtime_error("Not implemented: operator*()");
-  }
+  T& operator*() { return *this->get(); }
 
   /**
    * @brief Dereferences a `unique_ptr` and returns a const reference to the object.
    * @return A const reference to the object.
    */
-  const T& operator*() const {
-    /* STUDENT TODO: Implement the dereference operator (const) */
-    throw std::runtime_error("Not implemented: operator*() const");
-  }
+  const T& operator*() const { return *this->get(); }
 
   /**
    * @brief Returns a pointer to the object managed by the `unique_ptr`.
    * @note This allows for accessing the members of the managed object through the `->` operator.
    * @return A pointer to the object.
    */
-  T* operator->() {
-    /* STUDENT TODO: Implement the arrow operator */
-    throw std::runtime_error("Not implemented: operator->()");
-  }
+  T* operator->() { return this->get(); }
 
   /**
    * @brief Returns a const pointer to the object managed by the `unique_ptr`.
    * @note This allows for accessing the members of the managed object through the `->` operator.
    * @return A const pointer to the object.
    */
-  const T* operator->() const {
-    /* STUDENT TODO: Implement the arrow operator */
-    throw std::runtime_error("Not implemented: operator->() const");
-  }
+  const T* operator->() const { return this->get(); }
+};
 
-  /**
-   * @brief Returns whether or not the `unique_ptr` is non-null.
-   * @note This allows us to use a `unique_ptr` inside an if-statement.
-   * @return `true` if the `unique_ptr` is non-null, `false` otherwise.
-   */
-  operator bool() const {
-    /* STUDENT TODO: Implement the boolean conversion operator */
-    throw std::runtime_error("Not implemented: operator bool() const");
-  }
+/**
+ * @brief A `unique_ptr` that owns a dynamically allocated array, which it frees with
+ * `delete[]` by default.
+ * @tparam T The type of the array elements.
+ * @tparam Deleter A function object called with the pointer to dispose of the array.
+ */
+template <typename T, typename Deleter>
+class unique_ptr<T[], Deleter> : public detail::unique_ptr_base<T, Deleter> {
+private:
+  using base = detail::unique_ptr_base<T, Deleter>;
 
-  /** STUDENT TODO: In the space below, do the following:
-   * - Implement a destructor
-   * - Delete the copy constructor
-   * - Delete the copy assignment operator
-   * - Implement the move constructor
-   * - Implement the move assignment operator
+public:
+  unique_ptr(T* ptr) : base(ptr) {}
+  unique_ptr(T* ptr, Deleter deleter) : base(ptr, std::move(deleter)) {}
+  unique_ptr(std::nullptr_t) : base(nullptr) {}
+  unique_ptr() : unique_ptr(nullptr) {}
+
+  /**
+   * @brief Returns a reference to the element at `index` in the managed array.
    */
+  T& operator[](size_t index) { return this->get()[index]; }
+  const T& operator[](size_t index) const { return this->get()[index]; }
 };
 
 /**
@@ -103,9 +225,22 @@ public:
  * @tparam Args The types of the arguments to pass to the constructor of T.
  * @param args The arguments to pass to the constructor of T.
  */
-template <typename T, typename... Args> 
+template <typename T, typename... Args>
+  requires(!std::is_array_v<T>)
 unique_ptr<T> make_unique(Args&&... args) {
   return unique_ptr<T>(new T(std::forward<Args>(args)...));
 }
 
-}
\ No newline at end of file
+/**
+ * @brief Creates a new unique_ptr to a value-initialized array of `size` elements.
+ * @example auto ptr = make_unique<int[]>(10);
+ * @tparam T An array type of unknown bound, such as `int[]`.
+ * @param size The number of elements in the array.
+ */
+template <typename T>
+  requires std::is_unbounded_array_v<T>
+unique_ptr<T> make_unique(size_t size) {
+  return unique_ptr<T>(new std::remove_extent_t<T>[size]());
+}
+
+}
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define FAST_FIND_X86 1
+#endif
+
+/* ========================================================================= *
+ * A faster `find`                                                           *
+ * ========================================================================= */
+
+/* The `find` template in main.cpp works for every container, but it treats
+ * them all the same way: one element, one comparison, one step at a time.
+ * That is as good as it gets for a `std::list`, but not for the others:
+ *
+ *  - A `std::vector<int>` (or an array, or a raw pointer) keeps its elements
+ *    next to each other in memory, so a CPU with SIMD instructions can compare
+ *    8, 16 or 32 of them at once.
+ *  - A `std::set` or `std::unordered_set` can look a value up without scanning
+ *    at all, using its own member function `find`.
+ *
+ * `fast::find` has one overload per case, and uses concepts to pick which one
+ * runs. When more than one overload matches, the compiler prefers the one
+ * whose constraints are the most specific, so `std::contiguous_iterator`
+ * (which includes `std::input_iterator`) wins over `std::input_iterator`. */
+
+namespace fast
+{
+
+  /* Types whose values are equal exactly when their bytes are equal, so that
+   * comparing bytes many at a time gives the same answer as `==`.
+   *
+   * Floating point types are left out on purpose: `0.0 == -0.0` even though
+   * their bytes differ, and `NaN != NaN` even though their bytes match! */
+  template <typename T>
+  concept BytewiseComparable =
+      (std::integral<T> || std::is_enum_v<T> || std::is_pointer_v<T>) &&
+      (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+
+  template <typename T>
+  concept Integer = std::integral<T> && !std::same_as<T, bool>;
+
+  /* Searching for a `V` among `T`s can be done bytewise if `T` can, and if
+   * turning the `V` into a `T` can't change what it compares equal to. For
+   * example, searching a `std::vector<int>` for `3.5` has to compare as
+   * doubles, so it takes the ordinary path. */
+  template <typename T, typename V>
+  concept BytewiseSearchable =
+      BytewiseComparable<T> &&
+      ((Integer<T> && Integer<V>) || std::same_as<T, V> ||
+       (std::is_pointer_v<T> && std::is_pointer_v<V> && std::convertible_to<V, T>));
+
+  /* Containers that can find a key faster than a linear scan, like
+   * `std::set`, `std::map`, `std::unordered_set` and `std::unordered_map`.
+   * (For the maps, this means looking up a key, not a key/value pair.) */
+  template <typename C>
+  concept AssociativeContainer =
+      std::ranges::range<C> &&
+      requires(C& c, const typename std::remove_cvref_t<C>::key_type& key) {
+        { c.find(key) } -> std::same_as<std::ranges::iterator_t<C>>;
+      };
+
+  /* Looking up a `V` in `C` can use the container's own `find`. */
+  template <typename C, typename V>
+  concept KeyLookup =
+      AssociativeContainer<C> && std::convertible_to<const V&, typename std::remove_cvref_t<C>::key_type>;
+
+  namespace detail
+  {
+
+    /* The unsigned integer with the same size as `T`. */
+    template <typename T>
+    using bits_t = std::conditional_t<sizeof(T) == 1, uint8_t,
+                   std::conditional_t<sizeof(T) == 2, uint16_t,
+                   std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>>;
+
+    template <typename T>
+    const T* find_scalar(const T* first, const T* last, T value)
+    {
+      for (; first != last; ++first) {
+        if (*first == value) return first;
+      }
+      return last;
+    }
+
+#ifdef FAST_FIND_X86
+
+    /* Compares the 32 bytes at `p`, one `sizeof(T)`-byte lane at a time, to the
+     * lanes of `needle` and returns a bitmask with one bit per byte, set where
+     * the lanes match. */
+    template <typename T>
+    __attribute__((target("avx2"))) inline uint32_t match_avx2(const T* p, const __m256i& needle)
+    {
+      __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+      __m256i equal;
+      if constexpr (sizeof(T) == 2) equal = _mm256_cmpeq_epi16(block, needle);
+      else if constexpr (sizeof(T) == 4) equal = _mm256_cmpeq_epi32(block, needle);
+      else equal = _mm256_cmpeq_epi64(block, needle);
+      return static_cast<uint32_t>(_mm256_movemask_epi8(equal));
+    }
+
+    /* Compares 32 bytes of elements at a time, four blocks per iteration so that
+     * the loads of the next blocks overlap with the compares of the last. */
+    template <typename T>
+    __attribute__((target("avx2"))) const T* find_avx2(const T* first, const T* last, T value)
+    {
+      auto bits = std::bit_cast<bits_t<T>>(value);
+      __m256i needle;
+      if constexpr (sizeof(T) == 2) needle = _mm256_set1_epi16(static_cast<short>(bits));
+      else if constexpr (sizeof(T) == 4) needle = _mm256_set1_epi32(static_cast<int>(bits));
+      else needle = _mm256_set1_epi64x(static_cast<long long>(bits));
+
+      constexpr size_t lanes = 32 / sizeof(T);
+      for (; static_cast<size_t>(last - first) >= 4 * lanes; first += 4 * lanes) {
+        uint32_t m0 = match_avx2(first, needle);
+        uint32_t m1 = match_avx2(first + lanes, needle);
+        uint32_t m2 = match_avx2(first + 2 * lanes, needle);
+        uint32_t m3 = match_avx2(first + 3 * lanes, needle);
+        if ((m0 | m1 | m2 | m3) == 0) continue;
+        if (m0) return first + std::countr_zero(m0) / sizeof(T);
+        if (m1) return first + lanes + std::countr_zero(m1) / sizeof(T);
+        if (m2) return first + 2 * lanes + std::countr_zero(m2) / sizeof(T);
+        return first + 3 * lanes + std::countr_zero(m3) / sizeof(T);
+      }
+      for (; static_cast<size_t>(last - first) >= lanes; first += lanes) {
+        if (uint32_t m = match_avx2(first, needle)) {
+          return first + std::countr_zero(m) / sizeof(T);
+        }
+      }
+      return find_scalar(first, last, value);
+    }
+
+    static bool has_avx2()
+    {
+      static const bool supported = __builtin_cpu_supports("avx2");
+      return supported;
+    }
+
+#endif
+
+    /* Finds `value` in the contiguous elements [first, last). */
+    template <BytewiseComparable T>
+    const T* find_contiguous(const T* first, const T* last, T value)
+    {
+      if constexpr (sizeof(T) == 1) {
+        // The C library has had a vectorized search for single bytes forever
+        auto byte = std::bit_cast<unsigned char>(value);
+        auto found = std::memchr(first, byte, static_cast<size_t>(last - first));
+        return found ? static_cast<const T*>(found) : last;
+      } else {
+#ifdef FAST_FIND_X86
+        if (has_avx2()) return find_avx2(first, last, value);
+#endif
+        return find_scalar(first, last, value);
+      }
+    }
+
+  }
+
+  /* The ordinary version, for any iterator: the same loop as `::find`. */
+  template <std::input_iterator It, typename V>
+  It find(It first, It last, const V& value)
+  {
+    for (; first != last; ++first) {
+      if (*first == value) return first;
+    }
+    return first;
+  }
+
+  /* The vectorized version, for contiguous elements that can be compared
+   * bytewise: `std::vector<int>::iterator`, `char*`, `std::array<T*, N>`, ... */
+  template <std::contiguous_iterator It, typename V>
+    requires BytewiseSearchable<std::iter_value_t<It>, V>
+  It find(It first, It last, const V& value)
+  {
+    using T = std::iter_value_t<It>;
+    T target = static_cast<T>(value);
+    if constexpr (Integer<T> && Integer<V>) {
+      // `==` compares integers after converting both to a common type, so
+      // this is the only `T` that can equal `value`, and only if it survives
+      // the round trip: searching a `std::vector<char>` for 300 never succeeds
+      using Common = std::common_type_t<T, V>;
+      target = static_cast<T>(static_cast<Common>(value));
+      if (static_cast<Common>(target) != static_cast<Common>(value)) return last;
+    }
+
+    const T* begin = std::to_address(first);
+    const T* found = detail::find_contiguous(begin, begin + (last - first), target);
+    return first + (found - begin);
+  }
+
+  /* The version for whole containers, which scans them with one of the
+   * versions above... */
+  template <std::ranges::range C, typename V>
+  auto find(C& c, const V& value)
+  {
+    return fast::find(std::ranges::begin(c), std::ranges::end(c), value);
+  }
+
+  /* ...unless they can look the value up themselves. */
+  template <std::ranges::range C, typename V>
+    requires KeyLookup<C, V>
+  auto find(C& c, const V& value)
+  {
+    return c.find(value);
+  }
+
+  /* Describes which version `fast::find` picks for a container of type `C`
+   * and a value of type `V`. */
+  template <typename C, typename V>
+  const char* strategy()
+  {
+    using T = std::ranges::range_value_t<C>;
+    if constexpr (KeyLookup<C, V>) {
+      return "member find";
+    } else if constexpr (std::ranges::contiguous_range<C> && BytewiseSearchable<T, V>) {
+      if constexpr (sizeof(T) == 1) return "memchr";
+#ifdef FAST_FIND_X86
+      if (detail::has_avx2()) return "AVX2 compare + movemask";
+#endif
+      return "linear scan (no SIMD on this CPU)";
+    } else {
+      return "linear scan";
+    }
+  }
+
+}
@@ -1,8 +1,17 @@
 #include <iostream>
+#include <list>
+#include <random>
+#include <ranges>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <type_traits>
 #include <unordered_set>
 #include <vector>
 
+#include "fast_find.hpp"
+#include "min_max.hpp"
 #include "utils.hpp"
 
 /* ========================================================================= *
@@ -137,6 +146,78 @@ void test_find() {
   out() << expr3 << result << pit(us, it3) << end;
 }
 
+/* ========================================================================= *
+ * Code Demo:                                                                *
+ * A faster `find` using concepts                                            *
+ * ========================================================================= */
+
+/* `::find` above does the same thing for every container. `fast::find` (see
+ * fast_find.hpp) uses concepts to pick the fastest way to search each kind
+ * of container, while still being called the same way. Here is the version
+ * it picks for a few of them. */
+void test_find_fast() {
+  std::vector<int> v { 1, 2, 3, 4, 5 };
+  auto it1 = fast::find(v.begin(), v.end(), 3);
+  out() << "fast::find(v.begin(), v.end(), 3): " << result << pit(v, it1) << end;
+
+  std::unordered_set<std::string> us { "hello", "there", "welcome", "to", "cs106l!" };
+  auto it2 = fast::find(us, "welcome");
+  out() << "fast::find(us, \"welcome\"): " << result << pit(us, it2) << end;
+
+  out() << "std::vector<int>, int: " << result << fast::strategy<std::vector<int>, int>() << end;
+  out() << "std::string, char: " << result << fast::strategy<std::string, char>() << end;
+  out() << "std::vector<double>, double: " << result << fast::strategy<std::vector<double>, double>() << end;
+  out() << "std::list<int>, int: " << result << fast::strategy<std::list<int>, int>() << end;
+  out() << "std::set<int>, int: " << result << fast::strategy<std::set<int>, int>() << end;
+  out() << "std::unordered_set<std::string>, const char*: " << result
+        << fast::strategy<std::unordered_set<std::string>, const char*>() << end;
+}
+
+/* How much faster is it? Each search looks for a value that is only at the
+ * very end, so every version has to look at every element.
+ *
+ * Compile with optimizations (g++ -std=c++20 -O2 main.cpp -o main) to get
+ * meaningful numbers. */
+void benchmark_find() {
+  constexpr size_t size = 10'000'000;
+  volatile size_t sink = 0;
+
+  auto compare = [&](const std::string& label, auto& c, auto value) {
+    double basic = benchmarking::time_ns([&] { sink = sink + (::find(c.begin(), c.end(), value) != c.end()); });
+    double standard = benchmarking::time_ns([&] { sink = sink + (std::find(c.begin(), c.end(), value) != c.end()); });
+    double fast = benchmarking::time_ns([&] { sink = sink + (fast::find(c, value) != c.end()); });
+    benchmarking::print_row(label, { basic, standard, fast });
+  };
+
+  benchmarking::print_header({ "::find", "std::find", "fast::find" });
+
+  std::vector<char> chars(size, 'a');
+  chars.back() = 'b';
+  compare("std::vector<char> (10M), memchr", chars, 'b');
+
+  std::vector<short> shorts(size, 1);
+  shorts.back() = 2;
+  compare("std::vector<short> (10M), AVX2", shorts, short { 2 });
+
+  std::vector<int> ints(size, 1);
+  ints.back() = 2;
+  compare("std::vector<int> (10M), AVX2", ints, 2);
+
+  // Large vectors don't fit in the CPU's caches, so all three versions spend
+  // much of their time waiting on memory. Small ones show the full difference.
+  std::vector<int> cached_ints(size / 100, 1);
+  cached_ints.back() = 2;
+  compare("std::vector<int> (100K, in cache), AVX2", cached_ints, 2);
+
+  std::vector<long long> longs(size, 1);
+  longs.back() = 2;
+  compare("std::vector<long long> (10M), AVX2", longs, 2LL);
+
+  std::unordered_set<std::string> strings;
+  for (size_t i = 0; i < size / 10; ++i) strings.insert(std::to_string(i));
+  compare("std::unordered_set<std::string> (1M), member find", strings, std::string("999999"));
+}
+
 /* ========================================================================= *
  * Concepts                                                                  *
  * ========================================================================= */
@@ -260,6 +341,195 @@ void test_min_var() {
 }
 
 
+/* Each call to the recursive `min_var` above instantiates a new function for
+ * every suffix of its arguments: `min_var(a, b, c, d)` needs `min_var(b, c, d)`,
+ * `min_var(c, d)` and `min_var(d)`. For long packs, that is a lot of work for
+ * the compiler (and a deep call chain if they don't get inlined).
+ *
+ * A fold expression does the same job in one function. The comma fold
+ * `(expr, ...)` expands `expr` once for every element of the pack, in order,
+ * so the loop below is "unrolled" at compile time without any recursion. */
+template <Comparable T, Comparable... Args>
+T min_fold(const T& v, const Args&... rest) {
+  T m = v;
+  ((m = static_cast<T>(rest) < m ? static_cast<T>(rest) : m), ...);
+  return m;
+}
+
+void test_min_fold() {
+  auto m1 = min_fold(1);
+  out() << "min_fold(1): " << result << m1 << end;
+
+  auto m2 = min_fold<std::string>("cool", "variadic", "template!");
+  out() << "min_fold<std::string>(\"cool\", \"variadic\", \"template!\"): " << result << m2 << end;
+
+  auto m3 = min_fold<double>(10, 2.5, 3.0f);
+  out() << "min_fold<double>(10, 2.5, 3.0f): " << result << m3 << end;
+
+  // A pack of 256 arguments: with `min_var`, this would be 256 functions
+  auto m4 = []<size_t... I>(std::index_sequence<I...>) {
+    return min_fold(static_cast<int>((I * 7919) % 1000)...);
+  }(std::make_index_sequence<256>());
+  out() << "min_fold((i * 7919) % 1000 for i in 0..255): " << result << m4 << end;
+}
+
+
+/* ========================================================================= *
+ * Min and max of a whole range                                              *
+ * ========================================================================= */
+
+/* `min_var` finds the min of a fixed number of arguments, known at compile
+ * time. Usually, though, we have a container with any number of elements.
+ *
+ * `min_range`, `max_range` and `minmax_range` work for any range of
+ * `Comparable` elements. When the elements
+ * are numbers stored next to each other (e.g. a `std::vector<int>`), it uses
+ * the vectorized kernels in min_max.hpp; otherwise, it uses a simple loop.
+ * Just like `std::ranges::min`, the range must not be empty. */
+template <std::ranges::input_range R>
+  requires Comparable<std::ranges::range_value_t<R>>
+auto minmax_range(R&& r) {
+  using T = std::ranges::range_value_t<R>;
+  if constexpr (std::ranges::contiguous_range<R> && simd::Vectorizable<T>) {
+    return simd::minmax(std::ranges::data(r), std::ranges::size(r));
+  } else {
+    auto it = std::ranges::begin(r);
+    std::pair<T, T> m { *it, *it };
+    for (++it; it != std::ranges::end(r); ++it) {
+      if (*it < m.first) m.first = *it;
+      if (m.second < *it) m.second = *it;
+    }
+    return m;
+  }
+}
+
+template <std::ranges::input_range R>
+  requires Comparable<std::ranges::range_value_t<R>>
+auto min_range(R&& r) {
+  using T = std::ranges::range_value_t<R>;
+  if constexpr (std::ranges::contiguous_range<R> && simd::Vectorizable<T>) {
+    return simd::min(std::ranges::data(r), std::ranges::size(r));
+  } else {
+    return minmax_range(r).first;
+  }
+}
+
+template <std::ranges::input_range R>
+  requires Comparable<std::ranges::range_value_t<R>>
+auto max_range(R&& r) {
+  using T = std::ranges::range_value_t<R>;
+  if constexpr (std::ranges::contiguous_range<R> && simd::Vectorizable<T>) {
+    return simd::max(std::ranges::data(r), std::ranges::size(r));
+  } else {
+    return minmax_range(r).second;
+  }
+}
+
+void test_min_range() {
+  std::vector<int> v { 5, 3, 8, 1, 9, 2 };
+  out() << "min_range({ 5, 3, 8, 1, 9, 2 }): " << result << min_range(v) << end;
+  out() << "max_range({ 5, 3, 8, 1, 9, 2 }): " << result << max_range(v) << end;
+
+  std::list<std::string> names { "Jacob", "Fabio", "Arwen", "Aragorn" };
+  auto [first, last] = minmax_range(names);
+  out() << "minmax_range(std::list<std::string> { ... }): " << result << first << ", " << last << end;
+}
+
+/* On big arrays of numbers, the vectorized versions are several times faster
+ * than a one-at-a-time loop (compile with -O2 to see this). */
+void benchmark_min_max() {
+  volatile double sink = 0;
+
+  auto compare = [&](const std::string& label, const auto& v) {
+    double standard_min = benchmarking::time_ns([&] { sink = sink + std::ranges::min(v); }, 3);
+    double vector_min = benchmarking::time_ns([&] { sink = sink + min_range(v); }, 3);
+    benchmarking::print_row("min of " + label, { standard_min, vector_min });
+
+    double standard_minmax = benchmarking::time_ns([&] { sink = sink + std::ranges::minmax(v).max; }, 3);
+    double vector_minmax = benchmarking::time_ns([&] { sink = sink + minmax_range(v).second; }, 3);
+    benchmarking::print_row("minmax of " + label, { standard_minmax, vector_minmax });
+
+    if (std::ranges::min(v) != min_range(v) || std::ranges::max(v) != max_range(v))
+      std::cout << "min_range/max_range disagree with std::ranges!\n";
+  };
+
+  benchmarking::print_header({ "std::ranges", "min_range" });
+
+  std::mt19937 rng(106);
+  {
+    std::vector<int> ints(100'000'000);
+    for (auto& x : ints) x = static_cast<int>(rng());
+    compare("std::vector<int> (100M)", ints);
+
+    std::vector<int> cached_ints(ints.begin(), ints.begin() + 100'000);
+    compare("std::vector<int> (100K, in cache)", cached_ints);
+  }
+  {
+    std::vector<float> floats(100'000'000);
+    std::uniform_real_distribution<float> dist(-1e6f, 1e6f);
+    for (auto& x : floats) x = dist(rng);
+    compare("std::vector<float> (100M)", floats);
+  }
+  {
+    std::vector<double> doubles(100'000'000);
+    std::uniform_real_distribution<double> dist(-1e6, 1e6);
+    for (auto& x : doubles) x = dist(rng);
+    compare("std::vector<double> (100M)", doubles);
+  }
+}
+
+
+/* ========================================================================= *
+ * Printing type names                                                       *
+ * ========================================================================= */
+
+/* `type(x)` (see utils.hpp) prints the name of a type. The compiler only gives
+ * us a "mangled" name (e.g. `St6vectorIiSaIiEE` for `std::vector<int>`), so it
+ * has to be demangled. Running the `c++filt` program for each one is slow,
+ * since it starts two processes every time, so utils.hpp uses the demangler
+ * built into the C++ runtime instead, and remembers every name it has seen.
+ *
+ * This benchmark demangles 10,000 distinct type names,
+ * `std::integral_constant<int, 0>` through `std::integral_constant<int, 9999>`. */
+void benchmark_type_names() {
+  constexpr size_t count = 10'000;
+  constexpr size_t cxxfilt_count = 100; // c++filt is too slow to run on all of them
+  std::vector<std::string> mangled;
+  for (size_t i = 0; i < count; ++i)
+    mangled.push_back("St17integral_constantIiLi" + std::to_string(i) + "EE");
+
+  std::ostringstream printed;
+  double cxxfilt = benchmarking::time_ns([&] {
+    for (size_t i = 0; i < cxxfilt_count; ++i)
+      printed << demangling::demangle_with_cxxfilt(mangled[i]).value_or(mangled[i]) << "\n";
+  }, 1) * count / cxxfilt_count;
+  double in_process = benchmarking::time_ns([&] {
+    for (const auto& name : mangled)
+      printed << demangling::demangle_in_process(name).value_or(name) << "\n";
+  }, 1);
+
+  // The first time, `demangle` has to demangle every name; after that, they
+  // all come from the cache. Four threads share the work to show that the
+  // cache can be used from several at once.
+  auto demangle_all = [&] {
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; ++t) {
+      threads.emplace_back([&, t] {
+        for (size_t i = t; i < count; i += 4) demangling::demangle(mangled[i]);
+      });
+    }
+    for (auto& thread : threads) thread.join();
+  };
+  double cold = benchmarking::time_ns(demangle_all, 1);
+  double cached = benchmarking::time_ns(demangle_all, 1);
+
+  benchmarking::print_header({ "c++filt", "in process" });
+  benchmarking::print_row("10k type names (c++filt estimated from 100)", { cxxfilt, in_process });
+  benchmarking::print_row("demangle(), 10k names: first time vs. cached", { cold, cached });
+  out() << "demangle(\"" + mangled.back() + "\"): " << result << demangling::demangle(mangled.back()) << end;
+}
+
+
 /* ========================================================================= *
  * Harness for these examples                                                *
  * ========================================================================= */
@@ -269,9 +539,15 @@ test(test_min_basic);
 test(test_min_ref);
 test(test_min_flex);
 test(test_find);
+test(test_find_fast);
+benchmark(benchmark_find);
 test(test_min_constrained);
 test(test_min_var);
+test(test_min_fold);
+test(test_min_range);
+benchmark(benchmark_min_max);
+benchmark(benchmark_type_names);
 
-int main() {
-  return testing::run_tests();
+int main(int argc, char* argv[]) {
+  return testing::run_tests(argc, argv);
 }
\ No newline at end of file
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+/* ========================================================================= *
+ * Vectorized min/max                                                        *
+ * ========================================================================= */
+
+/* Finding the smallest of many numbers one comparison at a time makes the CPU
+ * wait for each comparison before starting the next. With SIMD, one
+ * instruction compares 32 bytes' worth of numbers at once (8 `int`s, 4
+ * `double`s), keeping one running minimum per lane; at the end, the lanes'
+ * minimums are combined. main.cpp uses these kernels for `min_range`,
+ * `max_range` and `minmax_range` when the elements are numbers stored next to
+ * each other in memory. */
+
+namespace simd
+{
+
+  /* The element types the kernels below can handle. */
+  template <typename T>
+  concept Vectorizable =
+      std::is_arithmetic_v<T> && !std::same_as<T, bool> &&
+      (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+
+  namespace detail
+  {
+
+    /* Scans [first, first + n), n >= 1, returning the smallest and/or largest
+     * element (whichever of `FindMin` and `FindMax` are set).
+     *
+     * NaNs behave as they do in `std::ranges::min`: a NaN as the first element
+     * is the answer, and NaNs anywhere else are skipped, since comparisons
+     * with NaN are always false. */
+    template <typename T, bool FindMin, bool FindMax>
+    std::pair<T, T> scan_scalar(const T* first, size_t n)
+    {
+      T lo = first[0], hi = first[0];
+      for (size_t i = 1; i < n; ++i) {
+        if constexpr (FindMin) if (first[i] < lo) lo = first[i];
+        if constexpr (FindMax) if (hi < first[i]) hi = first[i];
+      }
+      return { lo, hi };
+    }
+
+#if defined(__GNUC__) && defined(__x86_64__)
+
+    /* The same scan with AVX2. `Vec` is a GCC vector type, which supports the
+     * usual operators on every lane at once: `x < lo ? x : lo` compiles to one
+     * `vpminsd` for `int`, `vminps` for `float`, and so on. Two accumulators per
+     * result let two comparisons run at the same time. */
+    template <typename T, bool FindMin, bool FindMax>
+    __attribute__((target("avx2"))) std::pair<T, T> scan_avx2(const T* first, size_t n)
+    {
+      typedef T Vec __attribute__((vector_size(32)));
+      constexpr size_t lanes = 32 / sizeof(T);
+
+      // A NaN only wins if it comes first, so start every lane from a non-NaN
+      if (first[0] != first[0] || n < 2 * lanes) return scan_scalar<T, FindMin, FindMax>(first, n);
+
+      Vec lo0 = Vec{} + first[0], lo1 = lo0, hi0 = lo0, hi1 = lo0;
+      size_t i = 0;
+      for (; i + 2 * lanes <= n; i += 2 * lanes) {
+        Vec x0, x1;
+        std::memcpy(&x0, first + i, sizeof(Vec));
+        std::memcpy(&x1, first + i + lanes, sizeof(Vec));
+        if constexpr (FindMin) {
+          lo0 = x0 < lo0 ? x0 : lo0;
+          lo1 = x1 < lo1 ? x1 : lo1;
+        }
+        if constexpr (FindMax) {
+          hi0 = hi0 < x0 ? x0 : hi0;
+          hi1 = hi1 < x1 ? x1 : hi1;
+        }
+      }
+      lo0 = lo1 < lo0 ? lo1 : lo0;
+      hi0 = hi0 < hi1 ? hi1 : hi0;
+
+      T lo = first[0], hi = first[0];
+      for (size_t lane = 0; lane < lanes; ++lane) {
+        if (lo0[lane] < lo) lo = lo0[lane];
+        if (hi < hi0[lane]) hi = hi0[lane];
+      }
+      for (; i < n; ++i) {
+        if constexpr (FindMin) if (first[i] < lo) lo = first[i];
+        if constexpr (FindMax) if (hi < first[i]) hi = first[i];
+      }
+      return { lo, hi };
+    }
+
+    static bool has_avx2()
+    {
+      static const bool supported = __builtin_cpu_supports("avx2");
+      return supported;
+    }
+
+#endif
+
+    template <typename T, bool FindMin, bool FindMax>
+    std::pair<T, T> scan(const T* first, size_t n)
+    {
+#if defined(__GNUC__) && defined(__x86_64__)
+      if (has_avx2()) return scan_avx2<T, FindMin, FindMax>(first, n);
+#endif
+      return scan_scalar<T, FindMin, FindMax>(first, n);
+    }
+
+  }
+
+  /* The smallest of the `n` (at least one) elements starting at `first`. */
+  template <Vectorizable T>
+  T min(const T* first, size_t n)
+  {
+    return detail::scan<T, true, false>(first, n).first;
+  }
+
+  /* The largest of the `n` (at least one) elements starting at `first`. */
+  template <Vectorizable T>
+  T max(const T* first, size_t n)
+  {
+    return detail::scan<T, false, true>(first, n).second;
+  }
+
+  /* The smallest and largest of the `n` (at least one) elements starting at
+   * `first`, found in a single pass. */
+  template <Vectorizable T>
+  std::pair<T, T> minmax(const T* first, size_t n)
+  {
+    return detail::scan<T, true, true>(first, n);
+  }
+
+}
@@ -1,15 +1,37 @@
 #pragma once
 
 #include <algorithm>
+#include <chrono>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <functional>
 #include <optional>
 #include <ostream>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
+#if __has_include(<cxxabi.h>)
+#include <cxxabi.h>
+#define UTILS_HAS_CXXABI
+#endif
+
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 /* ========================================================================= *
  * Printing typenames/demangling                                             *
@@ -38,7 +60,9 @@ namespace demangling
     return result;
   }
 
-  static bool can_demangle()
+  /* Whether the `c++filt` program is installed. Checking runs it, so the
+   * answer is remembered. */
+  static bool can_demangle_with_cxxfilt()
   {
     static std::optional<bool> available;
 
@@ -48,20 +72,34 @@ namespace demangling
     int exec_status;
     execute("c++filt --version", &exec_status);
     available = (exec_status == 0);
+    return *available;
+  }
 
-    if (!available)
+  static bool can_demangle()
+  {
+#ifdef UTILS_HAS_CXXABI
+    return true;
+#else
+    static bool available = can_demangle_with_cxxfilt();
+    static bool warned = false;
+    if (!available && !warned)
+    {
       std::cerr << "\033[33mWarning: c++filt could not be found, so type names will be mangled.\033[0m\n\n";
-
-    return *available;
+      warned = true;
+    }
+    return available;
+#endif
   }
 
-  static std::string demangle(const std::string &mangled)
+  /* Demangles a type name by running `c++filt`, which works everywhere but
+   * starts two new processes (a shell and `c++filt`) every time. */
+  static std::optional<std::string> demangle_with_cxxfilt(const std::string &mangled)
   {
-    if (!can_demangle())
-      return mangled;
+    if (!can_demangle_with_cxxfilt())
+      return std::nullopt;
     auto demangled = execute("echo " + mangled + " | c++filt -t");
     if (!demangled.has_value())
-      return mangled;
+      return std::nullopt;
 
     auto rstrip = [](std::string str){
       auto end = std::find_if_not(str.rbegin(), str.rend(), isspace).base();
@@ -72,6 +110,42 @@ namespace demangling
     return rstrip(*demangled);
   }
 
+  /* Demangles a type name with the demangler built into the C++ runtime
+   * (GCC's and Clang's), without starting any processes. */
+  static std::optional<std::string> demangle_in_process(const std::string &mangled)
+  {
+#ifdef UTILS_HAS_CXXABI
+    int status = 0;
+    std::unique_ptr<char, decltype(&std::free)> demangled(
+        abi::__cxa_demangle(mangled.c_str(), nullptr, nullptr, &status), &std::free);
+    if (status == 0 && demangled)
+      return std::string(demangled.get());
+#endif
+    return std::nullopt;
+  }
+
+  /* Demangles a type name, in process if possible and with `c++filt`
+   * otherwise. Each name is only demangled once: the results are cached, and
+   * the cache can be used from several threads at once. */
+  static std::string demangle(const std::string &mangled)
+  {
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::string> cache;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (auto it = cache.find(mangled); it != cache.end())
+        return it->second;
+    }
+
+    // Demangle without holding the lock, so other threads aren't kept waiting
+    auto demangled = demangle_in_process(mangled);
+    if (!demangled.has_value() && can_demangle())
+      demangled = demangle_with_cxxfilt(mangled);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return cache.emplace(mangled, demangled.value_or(mangled)).first->second;
+  }
+
   template <typename T>
   struct Demangle
   {
@@ -141,6 +215,64 @@ static std::ostream& out() {
 static constexpr auto result = "\033[0m";
 static constexpr auto end = "\n";
 
+/* ========================================================================= *
+ * Benchmarking                                                              *
+ * ========================================================================= */
+
+namespace benchmarking
+{
+
+  /* Runs `f` `repetitions` times and returns the fastest run in nanoseconds.
+   * The fastest run is the one least disturbed by everything else going on. */
+  template <typename Func>
+  static double time_ns(Func f, size_t repetitions = 5)
+  {
+    double best = std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < repetitions; ++i)
+    {
+      auto start = std::chrono::steady_clock::now();
+      f();
+      auto end = std::chrono::steady_clock::now();
+      best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count());
+    }
+    return best;
+  }
+
+  static std::string format_ns(double ns)
+  {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    if (ns < 1e3) ss << ns << " ns";
+    else if (ns < 1e6) ss << ns / 1e3 << " us";
+    else ss << ns / 1e6 << " ms";
+    return ss.str();
+  }
+
+  /* Prints the column names of a table of timings, one column per version
+   * of the code being compared. */
+  static void print_header(const std::vector<std::string>& columns)
+  {
+    std::cout << "\033[90m" << std::left << std::setw(60) << "" << "\033[0m";
+    for (const auto& column : columns)
+      std::cout << std::right << std::setw(16) << column;
+    std::cout << std::right << std::setw(12) << "speedup" << "\n";
+  }
+
+  /* Prints one row of timings (in nanoseconds), and how many times faster
+   * the last column is than the first. */
+  static void print_row(const std::string& label, const std::vector<double>& timings)
+  {
+    std::cout << "\033[90m" << std::left << std::setw(60) << label << "\033[0m";
+    for (double ns : timings)
+      std::cout << std::right << std::setw(16) << format_ns(ns);
+    std::cout << std::right << std::setw(11) << std::fixed << std::setprecision(1)
+              << timings.front() / timings.back() << "x\n";
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+  }
+
+}
+
 namespace testing
 {
 
@@ -148,35 +280,347 @@ namespace testing
   {
     std::string name;
     std::function<void()> func;
+    bool benchmark = false; // Only runs when asked for by name, and alone
   };
 
   static std::vector<Test> tests;
 
   struct TestRegistrar
   {
-    TestRegistrar(std::string name, std::function<void()> func) { tests.push_back({name, func}); }
+    TestRegistrar(std::string name, std::function<void()> func, bool benchmark = false)
+    {
+      tests.push_back({name, func, benchmark});
+    }
   };
 
-  static int run_tests()
+  /* How to run the tests, from the command line:
+   *
+   *   ./main [-j N] [--no-fork] [--list] [name...]
+   *
+   * Only tests whose names contain one of the given names are run (all of them
+   * if none are given). Each test runs in its own forked child process, up to
+   * N at a time (by default, one per CPU core), so a test that crashes only
+   * ends its own process. `--no-fork` runs the tests one after another in this
+   * process instead, which is handy in a debugger. `--list` prints the names
+   * of the tests without running them.
+   *
+   * Benchmarks (registered with `benchmark(func)` instead of `test(func)`) are
+   * slow and use a lot of memory, so they only run when one of the given names
+   * matches them. They also run alone, never alongside another test, so that
+   * nothing competes with them for the CPU while they are being timed. */
+  struct Options
+  {
+    std::vector<std::string> filters;
+    size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+    bool fork = true;
+    bool list = false;
+  };
+
+  /* What happened when a test ran. */
+  struct Result
+  {
+    const Test* test = nullptr;
+    std::string output;     // What the test printed, if it ran in a child
+    double seconds = 0;     // Wall time
+    long peak_rss_kb = -1;  // Peak resident memory, or -1 if unknown
+    bool passed = true;
+    std::string status = "ok";
+  };
+
+  static std::optional<Options> parse_options(int argc, char** argv)
+  {
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+      std::string arg = argv[i];
+      if (arg == "-j" && i + 1 < argc)
+        options.jobs = std::max(1, std::atoi(argv[++i]));
+      else if (arg.rfind("-j", 0) == 0 && arg.size() > 2)
+        options.jobs = std::max(1, std::atoi(arg.c_str() + 2));
+      else if (arg == "--no-fork")
+        options.fork = false;
+      else if (arg == "--list")
+        options.list = true;
+      else if (!arg.empty() && arg[0] == '-')
+        return std::nullopt;
+      else
+        options.filters.push_back(arg);
+    }
+    return options;
+  }
+
+  /*
+   * Examples are picked by any part of their name. Benchmarks only by their
+   * whole name, or by a filter that starts with "benchmark", so that naming an
+   * example doesn't also start a slow benchmark with a similar name.
+   */
+  static bool selected(const Test& test, const Options& options)
+  {
+    if (options.filters.empty())
+      return !test.benchmark || options.list;
+    return std::any_of(options.filters.begin(), options.filters.end(), [&](const std::string& filter) {
+      if (test.benchmark && filter != test.name && filter.rfind("benchmark", 0) != 0)
+        return false;
+      return test.name.find(filter) != std::string::npos;
+    });
+  }
+
+  static void print_banner(const Test& test)
   {
-    demangling::can_demangle();
     const std::string style_bg = "\033[48;5;45m";
     const std::string style_reset = "\033[0m";
+    std::cout << style_bg
+              << std::setw(100) << std::setfill(' ')
+              << std::left << test.name
+              << style_reset << std::endl;
+  }
 
-    for (const auto &test : tests)
-    {
-      std::cout << style_bg
-                << std::setw(100) << std::setfill(' ')
-                << std::left << test.name
-                << style_reset << std::endl;
+  /* Runs a test in this process, letting it print straight to the terminal. */
+  static Result run_in_process(const Test& test)
+  {
+    Result result;
+    result.test = &test;
+    print_banner(test);
 
+    auto start = std::chrono::steady_clock::now();
+    try
+    {
       test.func();
-      std::cout << "\n\n";
     }
+    catch (const std::exception& e)
+    {
+      std::cout << "\033[31mUncaught exception: " << e.what() << "\033[0m\n";
+      result.passed = false;
+      result.status = "exception";
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "\n\n";
+    return result;
+  }
+
+#if defined(__unix__) || defined(__APPLE__)
+
+  /* Runs the tests in forked children, at most `jobs` at a time. Each child's
+   * output goes through a pipe, and is printed (in the order the tests were
+   * registered) once the child is done, so outputs never interleave. */
+  static std::vector<Result> run_forked(const std::vector<const Test*>& selected_tests, size_t jobs)
+  {
+    struct Running
+    {
+      pid_t pid;
+      int fd;
+      size_t index;
+      std::chrono::steady_clock::time_point start;
+    };
+
+    std::vector<Result> results(selected_tests.size());
+    std::vector<bool> done(selected_tests.size(), false);
+    std::vector<Running> running;
+    size_t next_to_start = 0, next_to_print = 0;
+
+    auto start_test = [&](size_t index) {
+      const Test& test = *selected_tests[index];
+      results[index].test = &test;
+
+      int fds[2];
+      if (pipe(fds) != 0)
+      {
+        results[index] = run_in_process(test);
+        done[index] = true;
+        return;
+      }
+      std::cout.flush();
+      fflush(stdout);
+
+      pid_t pid = fork();
+      if (pid == 0)
+      {
+        close(fds[0]);
+        dup2(fds[1], STDOUT_FILENO);
+        dup2(fds[1], STDERR_FILENO);
+        close(fds[1]);
+        // Flush every line, so that output before a crash isn't lost
+        setvbuf(stdout, nullptr, _IOLBF, BUFSIZ);
+        int code = 0;
+        try
+        {
+          test.func();
+        }
+        catch (const std::exception& e)
+        {
+          std::cout << "\033[31mUncaught exception: " << e.what() << "\033[0m\n";
+          code = 1;
+        }
+        std::cout.flush();
+        std::cerr.flush();
+        fflush(nullptr);
+        _exit(code);
+      }
+      close(fds[1]);
+      if (pid < 0)
+      {
+        close(fds[0]);
+        results[index] = run_in_process(test);
+        done[index] = true;
+        return;
+      }
+      running.push_back({ pid, fds[0], index, std::chrono::steady_clock::now() });
+    };
+
+    auto finish_test = [&](const Running& r) {
+      close(r.fd);
+      int status = 0;
+      struct rusage usage {};
+      while (wait4(r.pid, &status, 0, &usage) < 0 && errno == EINTR)
+      {
+      }
+
+      Result& result = results[r.index];
+      result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - r.start).count();
+      result.peak_rss_kb = usage.ru_maxrss;
+#if defined(__APPLE__)
+      result.peak_rss_kb /= 1024; // macOS reports bytes
+#endif
+      if (WIFSIGNALED(status))
+      {
+        result.passed = false;
+        result.status = std::string("killed: ") + strsignal(WTERMSIG(status));
+      }
+      else if (WIFEXITED(status) && WEXITSTATUS(status) != 0)
+      {
+        result.passed = false;
+        result.status = "exit " + std::to_string(WEXITSTATUS(status));
+      }
+      done[r.index] = true;
+    };
+
+    // Whether a benchmark is running, in which case nothing else may start
+    auto benchmark_running = [&] {
+      return std::any_of(running.begin(), running.end(),
+                         [&](const Running& r) { return selected_tests[r.index]->benchmark; });
+    };
+
+    while (next_to_print < selected_tests.size())
+    {
+      while (running.size() < jobs && next_to_start < selected_tests.size() && !benchmark_running())
+      {
+        if (selected_tests[next_to_start]->benchmark && !running.empty())
+          break; // Wait for the others to finish first
+        start_test(next_to_start++);
+      }
+
+      if (!running.empty())
+      {
+        std::vector<pollfd> fds;
+        for (const auto& r : running)
+          fds.push_back({ r.fd, POLLIN, 0 });
+        if (poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR)
+          break;
+
+        for (size_t i = fds.size(); i-- > 0;)
+        {
+          if (fds[i].revents == 0)
+            continue;
+          char buffer[4096];
+          ssize_t got = read(fds[i].fd, buffer, sizeof(buffer));
+          if (got > 0)
+          {
+            results[running[i].index].output.append(buffer, got);
+          }
+          else if (got == 0 || errno != EINTR)
+          {
+            finish_test(running[i]);
+            running.erase(running.begin() + i);
+          }
+        }
+      }
+
+      for (; next_to_print < selected_tests.size() && done[next_to_print]; ++next_to_print)
+      {
+        const Result& result = results[next_to_print];
+        if (result.output.empty() && result.peak_rss_kb < 0)
+          continue; // Ran in process, and already printed
+        print_banner(*result.test);
+        std::cout << result.output;
+        if (!result.passed)
+          std::cout << "\033[31m" << result.test->name << " failed (" << result.status << ")\033[0m\n";
+        std::cout << "\n\n";
+      }
+    }
+    return results;
+  }
 
-    return 0;
+#endif
+
+  /* Prints how long each test took and how much memory it used, slowest
+   * first. */
+  static void print_summary(std::vector<Result> results, double total_seconds)
+  {
+    std::sort(results.begin(), results.end(),
+              [](const Result& a, const Result& b) { return a.seconds > b.seconds; });
+
+    std::cout << "\033[48;5;45m" << std::left << std::setw(40) << "Test" << std::setw(30) << "Status"
+              << std::right << std::setw(15) << "Time" << std::setw(15) << "Peak RSS"
+              << "\033[0m\n";
+    size_t failed = 0;
+    double sum = 0;
+    for (const auto& result : results)
+    {
+      std::stringstream rss;
+      if (result.peak_rss_kb >= 0)
+        rss << std::fixed << std::setprecision(1) << result.peak_rss_kb / 1024.0 << " MB";
+      else
+        rss << "-";
+
+      std::cout << std::left << std::setw(40) << result.test->name
+                << (result.passed ? "" : "\033[31m") << std::setw(30) << result.status << "\033[0m"
+                << std::right << std::setw(15) << benchmarking::format_ns(result.seconds * 1e9)
+                << std::setw(15) << rss.str() << "\n";
+      failed += !result.passed;
+      sum += result.seconds;
+    }
+    std::cout << results.size() << " tests, " << failed << " failed, "
+              << benchmarking::format_ns(total_seconds * 1e9) << " total ("
+              << benchmarking::format_ns(sum * 1e9) << " across tests)\n";
+  }
+
+  static int run_tests(int argc = 0, char** argv = nullptr)
+  {
+    auto options = parse_options(argc, argv);
+    if (!options)
+    {
+      std::cerr << "Usage: " << argv[0] << " [-j N] [--no-fork] [--list] [name...]\n";
+      return 2;
+    }
+
+    std::vector<const Test*> selected_tests;
+    for (const auto& test : tests)
+      if (selected(test, *options))
+        selected_tests.push_back(&test);
+
+    if (options->list)
+    {
+      for (const Test* test : selected_tests)
+        std::cout << test->name << (test->benchmark ? " (benchmark: only runs when named)" : "") << "\n";
+      return 0;
+    }
+
+    demangling::can_demangle();
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Result> results;
+#if defined(__unix__) || defined(__APPLE__)
+    if (options->fork)
+      results = run_forked(selected_tests, options->jobs);
+    else
+#endif
+      for (const Test* test : selected_tests)
+        results.push_back(run_in_process(*test));
+
+    print_summary(results, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    return std::all_of(results.begin(), results.end(), [](const Result& r) { return r.passed; }) ? 0 : 1;
   }
 
 #define test(func) static testing::TestRegistrar registrar_##func(#func, func)
+#define benchmark(func) static testing::TestRegistrar registrar_##func(#func, func, true)
 
 }
@@ -1,8 +1,21 @@
 #include <iostream>
+#include <iomanip>
 #include <functional>
 #include <cmath>
 #include <utility>
 #include <chrono>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+#include "pixel_pool.h"
+#include "image_kernels.h"
+#include "photo_file.h"
 
 class Photo {
 public:
@@ -17,10 +30,48 @@ public:
   Photo& operator=(Photo&& other);
 #endif
 
+  // Reading and writing pixels
+  int get(int x, int y) const;
+  void set(int x, int y, int value);
+
+  // The whole image at once, row by row, for the kernels in image_kernels.h
+  int get_width() const;
+  int get_height() const;
+  const int* pixels() const;
+  int* pixels();
+
+  // Image files (see photo_file.h). A raw photo is mapped into memory rather
+  // than read, so its pixels are loaded as they are first used. With
+  // `Mapping::WriteBack`, changes to its pixels go to the file (call `sync` to
+  // wait for them to get there); with `Mapping::Private` they don't. A PPM is
+  // converted to pixels as it is opened, and can't be written back.
+  enum class Mapping { Private, WriteBack };
+  explicit Photo(const std::string& path, Mapping mapping = Mapping::Private, const char* tag = nullptr);
+  void sync() const;
+
+  // Saves as a PPM if `path` ends in .ppm (dropping alpha), or else as a raw
+  // photo. A photo with no pixels can't be saved.
+  void save(const std::string& path) const;
+
 private:
 	int width;
 	int height;
 	int* data;
+  // The file `data` points into, for Photos opened from raw photos
+  MappedFile file;
+
+#ifdef ENABLE_COPY_ON_WRITE
+  // Copy-on-write: copies of a Photo share the same `data`, and `owners`
+  // counts how many of them there are. Only when one of them is about to
+  // change a pixel does it get its own copy of the pixels (see `set`).
+  // Copies of a photo mapped with write-back get their own pixels right
+  // away, so the photo itself keeps writing to its file.
+  std::atomic<int>* owners = nullptr;
+
+  void share(const Photo& other);
+  void make_unique();
+#endif
+  void release();
 
   std::ostream& log() const;
   const char* tag = nullptr;
@@ -29,16 +80,21 @@ private:
 Photo::Photo(int width, int height, const char* tag)
 	: width(width)
 	, height(height)
-  , data(new int[width * height])
+  , data(PixelPool::acquire(width * height))
   , tag(tag)
 {
   log() << "Photo(" << width << ", " << height << ")" << std::endl;
+#ifdef ENABLE_COPY_ON_WRITE
+  owners = new std::atomic<int>(1);
+#endif
 }
 
+#ifndef ENABLE_COPY_ON_WRITE
+
 Photo::Photo(const Photo& other)
 	: width(other.width)
 	, height(other.height)
-	, data(new int[width * height])
+	, data(PixelPool::acquire(width * height))
 {
   log() << "Photo(const Photo&)" << std::endl;
   log() << "  ↪ copying " << width << "x" << height << " pixels..." << std::endl;
@@ -51,22 +107,193 @@ Photo& Photo::operator=(const Photo& other) {
 	if (this == &other) return *this;
 
   log() << "  ↪ cleaning up " << width << "x" << height << " pixels..." << std::endl;
-	delete[] data; // Clean up old pixels!
+	release(); // Clean up old pixels!
 
 	// Copy over new pixels!
 	width = other.width;
 	height = other.height;
-	data = new int[width * height];
+	data = PixelPool::acquire(width * height);
 
   log() << "  ↪ copying " << width << "x" << height << " pixels..." << std::endl;
 	std::copy(other.data, other.data + width * height, data);
 	return *this;
 }
 
+void Photo::release()
+{
+  if (file.address) unmap_file(file);
+  else PixelPool::release(data, width * height);
+}
+
+#else
+
+// With copy-on-write, a copy only shares the pixels: no matter how big the
+// photo is, copying it costs about as much as moving it
+Photo::Photo(const Photo& other)
+  : width(other.width)
+  , height(other.height)
+  , data(nullptr)
+{
+  log() << "Photo(const Photo&)" << std::endl;
+  share(other);
+}
+
+Photo& Photo::operator=(const Photo& other) {
+  log() << "Photo::operator=(const Photo&)" << std::endl;
+  // Check for self assignment (or for already sharing the same pixels)
+  if (data == other.data) return *this;
+
+  release();
+  width = other.width;
+  height = other.height;
+  share(other);
+  return *this;
+}
+
+void Photo::share(const Photo& other)
+{
+  if (other.file.write_back) {
+    log() << "  ↪ copying " << width << "x" << height << " pixels out of a written-back file..." << std::endl;
+    data = PixelPool::acquire(width * height);
+    std::copy(other.data, other.data + width * height, data);
+    owners = new std::atomic<int>(1);
+    return;
+  }
+  log() << "  ↪ sharing " << width << "x" << height << " pixels..." << std::endl;
+  data = other.data;
+  file = other.file;
+  owners = other.owners;
+  if (owners) owners->fetch_add(1);
+}
+
+void Photo::release()
+{
+  // The last owner cleans up
+  if (owners && owners->fetch_sub(1) == 1) {
+    log() << "  ↪ cleaning up " << width << "x" << height << " pixels..." << std::endl;
+    if (file.address) unmap_file(file);
+    else PixelPool::release(data, width * height);
+    delete owners;
+  }
+  data = nullptr;
+  file = {};
+  owners = nullptr;
+}
+
+void Photo::make_unique()
+{
+  if (!owners || owners->load() == 1) return;
+
+  log() << "  ↪ copying " << width << "x" << height << " pixels before writing..." << std::endl;
+  int* copy = PixelPool::acquire(width * height);
+  std::copy(data, data + width * height, copy);
+  release();
+  data = copy;
+  owners = new std::atomic<int>(1);
+}
+
+#endif
+
 Photo::~Photo()
 {
   log() << "~Photo()" << std::endl;
-	delete[] data;
+  release();
+}
+
+int Photo::get(int x, int y) const
+{
+  return data[y * width + x];
+}
+
+void Photo::set(int x, int y, int value)
+{
+#ifdef ENABLE_COPY_ON_WRITE
+  make_unique();
+#endif
+  data[y * width + x] = value;
+}
+
+int Photo::get_width() const { return width; }
+int Photo::get_height() const { return height; }
+const int* Photo::pixels() const { return data; }
+
+int* Photo::pixels()
+{
+  // Whoever asks for writable pixels might change any of them
+#ifdef ENABLE_COPY_ON_WRITE
+  make_unique();
+#endif
+  return data;
+}
+
+Photo::Photo(const std::string& path, Mapping mapping, const char* tag)
+  : width(0)
+  , height(0)
+  , data(nullptr)
+  , tag(tag)
+{
+  log() << "Photo(\"" << path << "\")" << std::endl;
+  MappedFile mapped = map_file(path, mapping == Mapping::WriteBack);
+  char* bytes = static_cast<char*>(mapped.address);
+
+  if (auto raw = read_raw_header(bytes, mapped.size)) {
+    // Use the file's pixels where they are: nothing is read until it is used
+    width = raw->width;
+    height = raw->height;
+    data = reinterpret_cast<int*>(bytes + sizeof(RawHeader));
+    file = mapped;
+  } else if (auto ppm = read_ppm_header(bytes, mapped.size); ppm && mapping == Mapping::Private) {
+    log() << "  ↪ converting " << ppm->width << "x" << ppm->height << " pixels..." << std::endl;
+    width = ppm->width;
+    height = ppm->height;
+    data = PixelPool::acquire(width * height);
+    const unsigned char* rgb = reinterpret_cast<const unsigned char*>(bytes + ppm->size);
+    for (int i = 0; i < width * height; ++i, rgb += 3)
+      data[i] = image::pack(255, rgb[0], rgb[1], rgb[2]);
+    unmap_file(mapped);
+  } else {
+    unmap_file(mapped);
+    throw std::invalid_argument(path + (ppm ? " is a PPM, which can't be written back"
+                                            : " is not a raw photo or a binary PPM with 8-bit channels"));
+  }
+#ifdef ENABLE_COPY_ON_WRITE
+  owners = new std::atomic<int>(1);
+#endif
+}
+
+void Photo::sync() const
+{
+  sync_file(file);
+}
+
+void Photo::save(const std::string& path) const
+{
+  log() << "Photo::save(\"" << path << "\")" << std::endl;
+  // Opening a photo with no pixels would fail, so don't write one
+  if (!valid_size(width, height))
+    throw std::invalid_argument("can't save a " + std::to_string(width) + "x" + std::to_string(height) + " photo to " + path);
+  size_t pixels = size_t(width) * height;
+  if (has_ppm_extension(path)) {
+    std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+    write_file(path, header.size() + pixels * 3, [&](char* bytes) {
+      std::copy(header.begin(), header.end(), bytes);
+      unsigned char* rgb = reinterpret_cast<unsigned char*>(bytes + header.size());
+      for (size_t i = 0; i < pixels; ++i, rgb += 3) {
+        rgb[0] = image::channel(data[i], 16);
+        rgb[1] = image::channel(data[i], 8);
+        rgb[2] = image::channel(data[i], 0);
+      }
+    });
+  } else {
+    RawHeader header {};
+    std::copy(std::begin(kRawMagic), std::end(kRawMagic), header.magic);
+    header.width = width;
+    header.height = height;
+    write_file(path, sizeof(header) + pixels * sizeof(int), [&](char* bytes) {
+      std::memcpy(bytes, &header, sizeof(header));
+      std::memcpy(bytes + sizeof(header), data, pixels * sizeof(int));
+    });
+  }
 }
 
 #ifdef ENABLE_MOVE_SEMANTICS
@@ -75,9 +302,15 @@ Photo::Photo(Photo&& other)
   : width(other.width)
   , height(other.height)
   , data(other.data)
+  , file(other.file)
 {
   log() << "Photo(Photo&&)" << std::endl;
   other.data = nullptr;
+  other.file = {};
+#ifdef ENABLE_COPY_ON_WRITE
+  owners = other.owners;
+  other.owners = nullptr;
+#endif
 }
 
 Photo& Photo::operator=(Photo&& other)
@@ -85,12 +318,18 @@ Photo& Photo::operator=(Photo&& other)
   log() << "Photo::operator=(Photo&&)" << std::endl;
 
   // Clean up our data before assigning into this
-  delete[] data;
+  release();
 
   width = other.width;
   height = other.height;
   data = other.data;
   other.data = nullptr;
+  file = other.file;
+  other.file = {};
+#ifdef ENABLE_COPY_ON_WRITE
+  owners = other.owners;
+  other.owners = nullptr;
+#endif
 
   return *this;
 }
@@ -105,7 +344,7 @@ std::ostream& Photo::log() const
 }
 
 template <typename Func>
-void time_func(Func f, size_t invocations)
+std::chrono::nanoseconds::rep time_per_call(Func f, size_t invocations)
 {
   // Temporarily disable logging
   std::cout.setstate(std::ios_base::failbit);
@@ -118,7 +357,24 @@ void time_func(Func f, size_t invocations)
   // Re-enable logging
   std::cout.clear();
 
-  std::cout << "Average time spent per call: " << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / invocations << "ns" << std::endl;
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / invocations;
+}
+
+// Times `f` with pixels from the system allocator, then from the PixelPool
+template <typename Func>
+void time_func(const std::string& label, Func f, size_t invocations)
+{
+  PixelPool::set_enabled(false);
+  auto without_pool = time_per_call(f, invocations);
+
+  PixelPool::set_enabled(true);
+  PixelPool::reset_stats();
+  auto with_pool = time_per_call(f, invocations);
+  auto stats = PixelPool::stats();
+
+  std::cout << "Average time spent per call to " << label << ": "
+            << without_pool << "ns, or " << with_pool << "ns with the pixel pool ("
+            << std::fixed << std::setprecision(1) << stats.hit_rate() << "% pool hits)" << std::endl;
 }
 
 Photo take_photo()
@@ -133,13 +389,249 @@ void run_example()
   selfie = take_photo();
 }
 
-int main() {
-  std::cout << "Example run:\n\n";
+// Code that copies photos around a lot, but mostly just looks at them
+void copy_example()
+{
+  Photo original(500, 500, "original");
+  original.set(0, 0, 106);
+
+  Photo copy = original;
+  Photo another(0, 0, "another");
+  another = copy;
+  if (another.get(0, 0) != 106) std::cout << "Copy has the wrong pixels!" << std::endl;
+}
+
+// Code that copies a photo and then changes the copy, which has to copy the
+// pixels, even with copy-on-write
+void copy_then_edit_example()
+{
+  Photo original(500, 500, "original");
+  original.set(0, 0, 106);
+
+  Photo edited = original;
+  edited.set(0, 0, 107);
+  if (original.get(0, 0) != 106) std::cout << "Editing a copy changed the original!" << std::endl;
+}
+
+// A fingerprint of a photo's pixels, to check that every thread count gets the
+// same answer
+uint64_t checksum(const Photo& photo)
+{
+  uint64_t hash = 0;
+  const int* pixels = photo.pixels();
+  for (size_t i = 0; i < size_t(photo.get_width()) * photo.get_height(); ++i)
+    hash = hash * 1099511628211ull + static_cast<uint32_t>(pixels[i]);
+  return hash;
+}
+
+// Times the kernels in image_kernels.h on a size x size photo with 1, 2, 4, ...
+// threads, up to `max_threads`
+int benchmark_kernels(int size, size_t max_threads)
+{
+  Photo photo(size, size);
+  uint32_t state = 106;
+  for (int* p = photo.pixels(); p != photo.pixels() + size_t(size) * size; ++p) {
+    state = state * 1664525 + 1013904223;
+    *p = static_cast<int>(state | 0xFF000000);
+  }
+
+  std::vector<size_t> thread_counts;
+  for (size_t threads = 1; threads < max_threads; threads *= 2) thread_counts.push_back(threads);
+  thread_counts.push_back(max_threads);
+
+  struct Kernel {
+    std::string label;
+    std::function<Photo(const image::Options&)> run;
+  };
+  std::vector<Kernel> kernels = {
+    { "grayscale", [&](const image::Options& options) { return image::transformed(photo, image::grayscale, options); } },
+    { "box_blur (radius 3)", [&](const image::Options& options) { return image::box_blur(photo, 3, options); } },
+    { "gaussian_blur (sigma 2)", [&](const image::Options& options) { return image::gaussian_blur(photo, 2.0f, options); } },
+    { "resize (to half size)", [&](const image::Options& options) { return image::resize(photo, size / 2, size / 2, options); } },
+    { "resize (to double size)", [&](const image::Options& options) { return image::resize(photo, size * 2, size * 2, options); } },
+  };
+
+  // Blurring by nothing has to leave the photo as it was
+  if (checksum(image::gaussian_blur(photo, 0.0f)) != checksum(photo) || checksum(image::box_blur(photo, 0)) != checksum(photo)) {
+    std::cout << "A blur of size 0 changed the photo!" << std::endl;
+    return 1;
+  }
+
+  std::cout << "Kernels on a " << size << "x" << size << " photo, in megapixels (of input) per second:\n\n";
+  std::cout << std::left << std::setw(26) << "kernel" << std::right;
+  for (size_t threads : thread_counts)
+    std::cout << std::setw(12) << (std::to_string(threads) + (threads == 1 ? " thread" : " threads"));
+  std::cout << std::endl;
+
+  for (const auto& kernel : kernels) {
+    std::cout << std::left << std::setw(26) << kernel.label << std::right << std::fixed << std::setprecision(1);
+    uint64_t expected = 0;
+    for (size_t threads : thread_counts) {
+      image::Options options;
+      options.threads = threads;
+      auto start = std::chrono::steady_clock::now();
+      Photo output = kernel.run(options);
+      auto end = std::chrono::steady_clock::now();
+      std::cout << std::setw(12) << size_t(size) * size / std::chrono::duration<double, std::micro>(end - start).count()
+                << std::flush;
+
+      uint64_t result = checksum(output);
+      if (threads == 1) expected = result;
+      else if (result != expected) {
+        std::cout << "\n" << kernel.label << " gave a different answer with " << threads << " threads!" << std::endl;
+        return 1;
+      }
+    }
+    std::cout << std::endl;
+  }
+  return 0;
+}
+
+// The usual way to load a photo: read all of the file with a stream, and only
+// then look at the pixels
+Photo load_with_stream(const std::string& path)
+{
+  std::ifstream in(path, std::ios::binary);
+  RawHeader raw;
+  if (in.read(reinterpret_cast<char*>(&raw), sizeof(raw)) && read_raw_header(reinterpret_cast<const char*>(&raw), SIZE_MAX)) {
+    Photo photo(raw.width, raw.height);
+    in.read(reinterpret_cast<char*>(photo.pixels()), std::streamsize(raw.width) * raw.height * sizeof(int));
+    return photo;
+  }
+
+  // Otherwise it's a PPM (written by Photo::save, so the header is simple)
+  in.clear();
+  in.seekg(0);
+  std::string magic;
+  int width, height, max_value;
+  in >> magic >> width >> height >> max_value;
+  in.get();
+  Photo photo(width, height);
+  std::vector<unsigned char> rgb(size_t(width) * height * 3);
+  in.read(reinterpret_cast<char*>(rgb.data()), rgb.size());
+  int* pixels = photo.pixels();
+  for (size_t i = 0; i < size_t(width) * height; ++i)
+    pixels[i] = image::pack(255, rgb[3 * i], rgb[3 * i + 1], rgb[3 * i + 2]);
+  return photo;
+}
+
+// Times opening a photo file until its first pixel can be read, and until all
+// of its pixels have been read, with the file in the page cache (warm) or on
+// disk (cold)
+template <typename Open>
+uint64_t time_loading(const std::string& label, const std::string& path, bool cold, Open open)
+{
+  if (cold) evict_from_page_cache(path);
+
+  auto start = std::chrono::steady_clock::now();
+  Photo photo = open(path);
+  volatile int first_pixel = photo.get(0, 0);
+  (void) first_pixel;
+  auto opened = std::chrono::steady_clock::now();
+  uint64_t result = checksum(photo);
+  auto scanned = std::chrono::steady_clock::now();
+
+  auto us = [](auto duration) { return std::chrono::duration<double, std::micro>(duration).count(); };
+  size_t pixels = size_t(photo.get_width()) * photo.get_height();
+  std::cout << std::left << std::setw(28) << (label + (cold ? " (cold)" : " (warm)")) << std::right << std::fixed
+            << std::setprecision(1) << std::setw(18) << us(opened - start) << std::setw(18)
+            << us(scanned - start) / 1000 << std::setw(12) << pixels / us(scanned - start) << std::endl;
+  return result;
+}
+
+// Saves a size x size photo as a raw photo and as a PPM, then compares opening
+// and scanning them with a stream and with mmap
+int benchmark_files(int size)
+{
+  auto directory = std::filesystem::temp_directory_path();
+  std::string raw_path = directory / "cs106l_photo.raw", ppm_path = directory / "cs106l_photo.ppm";
+  uint64_t expected;
+  {
+    Photo photo(size, size);
+    uint32_t state = 106;
+    for (int* p = photo.pixels(); p != photo.pixels() + size_t(size) * size; ++p) {
+      state = state * 1664525 + 1013904223;
+      *p = static_cast<int>(state | 0xFF000000);
+    }
+    expected = checksum(photo);
+    auto start = std::chrono::steady_clock::now();
+    photo.save(raw_path);
+    auto saved_raw = std::chrono::steady_clock::now();
+    photo.save(ppm_path);
+    auto saved_ppm = std::chrono::steady_clock::now();
+    std::cout << "Saved a " << size << "x" << size << " photo as a raw photo ("
+              << std::chrono::duration_cast<std::chrono::milliseconds>(saved_raw - start).count() << "ms) and a PPM ("
+              << std::chrono::duration_cast<std::chrono::milliseconds>(saved_ppm - saved_raw).count() << "ms)\n\n";
+  }
+
+  // Changes made with write-back reach the file, even after the photo has
+  // been copied, and private ones (including the copy's) don't
+  {
+    Photo photo(raw_path, Photo::Mapping::WriteBack);
+    int original = photo.get(size - 1, size - 1);
+    Photo backup = photo;
+    photo.set(size - 1, size - 1, 106);
+    photo.sync();
+    backup.set(0, 0, 108);
+    Photo changed(raw_path);
+    changed.set(0, 0, 107);
+    if (Photo(raw_path).get(size - 1, size - 1) != 106 || Photo(raw_path).get(0, 0) == 107 ||
+        Photo(raw_path).get(0, 0) == 108 || backup.get(size - 1, size - 1) != original) {
+      std::cout << "Write-back didn't work!" << std::endl;
+      return 1;
+    }
+    photo.set(size - 1, size - 1, original);
+    photo.sync();
+  }
+
+  std::cout << std::left << std::setw(28) << "load" << std::right << std::setw(18) << "first pixel (us)"
+            << std::setw(18) << "all pixels (ms)" << std::setw(12) << "MP/s" << std::endl;
+  for (bool cold : { true, false }) {
+    uint64_t results[] = {
+      time_loading("raw photo, stream", raw_path, cold, load_with_stream),
+      time_loading("raw photo, mmap", raw_path, cold, [](const std::string& path) { return Photo(path); }),
+      time_loading("PPM, stream", ppm_path, cold, load_with_stream),
+      time_loading("PPM, mmap", ppm_path, cold, [](const std::string& path) { return Photo(path); }),
+    };
+    for (uint64_t result : results) {
+      if (result != expected) {
+        std::cout << "A photo loaded with the wrong pixels!" << std::endl;
+        return 1;
+      }
+    }
+  }
+  std::filesystem::remove(raw_path);
+  std::filesystem::remove(ppm_path);
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc > 1 && std::string(argv[1]) == "--benchmark-kernels") {
+    int size = argc > 2 ? std::atoi(argv[2]) : 8192;
+    size_t threads = argc > 3 ? std::atoi(argv[3]) : std::max(1u, std::thread::hardware_concurrency());
+    return benchmark_kernels(std::max(size, 2), std::max<size_t>(threads, 1));
+  }
+  if (argc > 1 && std::string(argv[1]) == "--benchmark-files")
+    return benchmark_files(std::max(argc > 2 ? std::atoi(argv[2]) : 8192, 1));
+
+  std::cout << "Example run ("
+#if defined(ENABLE_MOVE_SEMANTICS) && defined(ENABLE_COPY_ON_WRITE)
+            << "move semantics + copy-on-write"
+#elif defined(ENABLE_MOVE_SEMANTICS)
+            << "move semantics"
+#elif defined(ENABLE_COPY_ON_WRITE)
+            << "copy-on-write"
+#else
+            << "copies only"
+#endif
+            << "):\n\n";
   run_example();
   std::cout << "\n\n";
 
   constexpr size_t invocations = 10000;
   std::cout << "Timing " << invocations << " attempts to move/copy a Photo..." << std::endl;
-  time_func(run_example, invocations);
+  time_func("run_example", run_example, invocations);
+  time_func("copy_example", copy_example, invocations);
+  time_func("copy_then_edit_example", copy_then_edit_example, invocations);
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Image files that are mapped into memory with `mmap` instead of read with a
+ * stream (POSIX only).
+ *
+ * Reading a file with a stream copies every byte into a buffer before the
+ * program sees any of them. Mapping it just reserves addresses: a page (4 KB)
+ * of the file is read the first time the program touches it, straight from
+ * the operating system's page cache, which every process that maps the same
+ * file shares. Opening a huge image this way takes microseconds, no matter
+ * how big it is.
+ *
+ * Two formats are supported:
+ *  - Raw photos: a 16-byte header, then the pixels exactly as `Photo` keeps
+ *    them in memory (one int each, row by row). These can be used in place.
+ *  - Binary PPM (P6), which most image programs understand. Its pixels are
+ *    3 bytes each, so they have to be converted, and they have no alpha.
+ */
+
+struct MappedFile {
+  void* address = nullptr;
+  size_t size = 0;
+  bool write_back = false; // Whether changes to the mapping go to the file
+};
+
+inline std::system_error file_error(const std::string& what, const std::string& path)
+{
+  return std::system_error(errno, std::generic_category(), what + " " + path);
+}
+
+// Maps all of the file at `path`. With `write_back`, changes to the mapping
+// are written to the file; without it, they stay in this process's memory.
+inline MappedFile map_file(const std::string& path, bool write_back)
+{
+  int fd = ::open(path.c_str(), write_back ? O_RDWR : O_RDONLY);
+  if (fd < 0) throw file_error("can't open", path);
+
+  struct stat info;
+  if (::fstat(fd, &info) < 0) {
+    ::close(fd);
+    throw file_error("can't read", path);
+  }
+  if (info.st_size == 0) {
+    ::close(fd);
+    throw std::invalid_argument(path + " is empty");
+  }
+  MappedFile file { nullptr, static_cast<size_t>(info.st_size), write_back };
+  file.address = ::mmap(nullptr, file.size, PROT_READ | PROT_WRITE, write_back ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+  ::close(fd); // The mapping keeps the file open
+  if (file.address == MAP_FAILED) throw file_error("can't map", path);
+  return file;
+}
+
+inline void unmap_file(MappedFile& file)
+{
+  if (file.address) ::munmap(file.address, file.size);
+  file = {};
+}
+
+// Writes the pages of `file` that were changed back to disk, and waits for
+// them to get there
+inline void sync_file(const MappedFile& file)
+{
+  if (file.address && ::msync(file.address, file.size, MS_SYNC) < 0)
+    throw std::system_error(errno, std::generic_category(), "can't write back mapped file");
+}
+
+// Writes a `size`-byte file at `path` by mapping it and calling `fill` with
+// its bytes. The file is written under a temporary name and then renamed, so
+// nothing that has the old file mapped (or open) sees a half-written one. If
+// anything goes wrong, the temporary file is removed.
+template <typename Fill>
+void write_file(const std::string& path, size_t size, Fill fill)
+{
+  std::string temporary = path + ".tmp";
+  int fd = ::open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) throw file_error("can't create", temporary);
+  auto fail = [&](const std::string& what, const std::string& name) {
+    auto error = file_error(what, name);
+    ::unlink(temporary.c_str());
+    return error;
+  };
+
+  if (::ftruncate(fd, static_cast<off_t>(size)) < 0) {
+    auto error = fail("can't resize", temporary);
+    ::close(fd);
+    throw error;
+  }
+  void* address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (address == MAP_FAILED) {
+    auto error = fail("can't map", temporary);
+    ::close(fd);
+    throw error;
+  }
+  ::close(fd);
+
+  try {
+    fill(static_cast<char*>(address));
+  } catch (...) {
+    ::munmap(address, size);
+    ::unlink(temporary.c_str());
+    throw;
+  }
+  ::munmap(address, size);
+  if (std::rename(temporary.c_str(), path.c_str()) < 0) throw fail("can't rename to", path);
+}
+
+// Asks the operating system to drop `path` from its page cache, so the next
+// read has to go to the disk. Only for benchmarks.
+inline void evict_from_page_cache(const std::string& path)
+{
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return;
+  ::fdatasync(fd);
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  ::close(fd);
+}
+
+// Photo indexes its pixels with ints, which limits how many it can have
+inline bool valid_size(uint64_t width, uint64_t height)
+{
+  return width > 0 && height > 0 && width <= INT_MAX && height <= INT_MAX && width * height <= INT_MAX;
+}
+
+/* Raw photos */
+
+struct RawHeader {
+  char magic[8];
+  uint32_t width;
+  uint32_t height;
+};
+
+inline constexpr char kRawMagic[8] = { 'C', 'S', '1', '0', '6', 'L', 'P', 'H' };
+
+// Reads the header of a raw photo, if `bytes` starts with one and is long
+// enough to hold all of its pixels
+inline std::optional<RawHeader> read_raw_header(const char* bytes, size_t size)
+{
+  RawHeader header;
+  if (size < sizeof(header)) return std::nullopt;
+  std::memcpy(&header, bytes, sizeof(header));
+  if (std::memcmp(header.magic, kRawMagic, sizeof(kRawMagic)) != 0) return std::nullopt;
+  if (!valid_size(header.width, header.height)) return std::nullopt;
+  if (size - sizeof(header) < uint64_t(header.width) * header.height * sizeof(int)) return std::nullopt;
+  return header;
+}
+
+/* PPM */
+
+struct PpmHeader {
+  int width;
+  int height;
+  size_t size; // Of the header itself: the pixels start right after it
+};
+
+// Reads the header of a binary PPM with one byte per channel ("P6 <width>
+// <height> 255", with optional # comments), if `bytes` starts with one and is
+// long enough to hold all of its pixels
+inline std::optional<PpmHeader> read_ppm_header(const char* bytes, size_t size)
+{
+  if (size < 2 || bytes[0] != 'P' || bytes[1] != '6') return std::nullopt;
+
+  size_t i = 2;
+  auto next_number = [&]() -> long {
+    while (i < size && (std::isspace(static_cast<unsigned char>(bytes[i])) || bytes[i] == '#')) {
+      if (bytes[i] == '#')
+        while (i < size && bytes[i] != '\n') ++i;
+      else
+        ++i;
+    }
+    long value = -1;
+    for (; i < size && bytes[i] >= '0' && bytes[i] <= '9'; ++i) {
+      value = (value < 0 ? 0 : value * 10) + (bytes[i] - '0');
+      if (value > INT_MAX) return -1;
+    }
+    return value;
+  };
+  long width = next_number(), height = next_number(), max_value = next_number();
+  if (!valid_size(width, height) || max_value != 255 || i >= size) return std::nullopt;
+
+  // Exactly one whitespace character separates the header from the pixels
+  PpmHeader header { static_cast<int>(width), static_cast<int>(height), i + 1 };
+  if (size - header.size < uint64_t(width) * height * 3) return std::nullopt;
+  return header;
+}
+
+inline bool has_ppm_extension(const std::string& path)
+{
+  return path.size() >= 4 && path.compare(path.size() - 4, 4, ".ppm") == 0;
+}
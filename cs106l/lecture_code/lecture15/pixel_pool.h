@@ -0,0 +1,154 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/*
+ * A pool of pixel buffers, so that a new Photo can reuse the pixels of a
+ * Photo that was just destroyed instead of going back to the system allocator.
+ *
+ * Big allocations are expensive: for a 500x500 photo, `new int[]` maps fresh
+ * memory from the operating system, and every page of it faults the first time
+ * it is touched; `delete[]` then hands it all back. The pool keeps freed
+ * buffers around instead, sorted into size classes (powers of two), so a
+ * buffer can be reused for any photo of a similar size.
+ *
+ * Each thread keeps a few free buffers of each size class to itself, so most
+ * requests don't need a lock. When a thread has too many, the extras go to a
+ * shared (locked) list that every thread can take from.
+ */
+class PixelPool {
+public:
+  /* Returns a buffer with room for at least `pixels` pixels. */
+  static int* acquire(size_t pixels)
+  {
+    // Even without the pool, round up to the size class, so the buffer can
+    // join the pool if it is turned on before the buffer is released
+    size_t size_class = class_of(pixels);
+    if (!enabled()) return new int[capacity_of(size_class)];
+
+    auto& local = local_lists()[size_class];
+    if (!local.empty()) {
+      int* buffer = local.back();
+      local.pop_back();
+      hits.fetch_add(1, std::memory_order_relaxed);
+      return buffer;
+    }
+    {
+      std::lock_guard<std::mutex> lock(global().mutex);
+      auto& shared = global().lists[size_class];
+      if (!shared.empty()) {
+        int* buffer = shared.back();
+        shared.pop_back();
+        hits.fetch_add(1, std::memory_order_relaxed);
+        return buffer;
+      }
+    }
+    misses.fetch_add(1, std::memory_order_relaxed);
+    return new int[capacity_of(size_class)];
+  }
+
+  /* Gives back a buffer from `acquire(pixels)`. */
+  static void release(int* buffer, size_t pixels)
+  {
+    if (!buffer) return;
+    if (!enabled()) {
+      delete[] buffer;
+      return;
+    }
+
+    size_t size_class = class_of(pixels);
+    auto& local = local_lists()[size_class];
+    if (local.size() < kLocalLimit) {
+      local.push_back(buffer);
+      return;
+    }
+    give_to_global(size_class, buffer);
+  }
+
+  /* Turns the pool on or off (it starts on). While it is off, buffers come
+   * straight from `new[]` and go straight back to `delete[]`. */
+  static void set_enabled(bool on) { is_enabled.store(on, std::memory_order_relaxed); }
+  static bool enabled() { return is_enabled.load(std::memory_order_relaxed); }
+
+  /* How many requests were served with a reused buffer (hits) or a new one
+   * (misses) since the last call to `reset_stats`. */
+  struct Stats {
+    size_t hits;
+    size_t misses;
+
+    double hit_rate() const { return hits + misses == 0 ? 0 : 100.0 * hits / (hits + misses); }
+  };
+
+  static Stats stats() { return { hits.load(), misses.load() }; }
+  static void reset_stats() { hits = 0; misses = 0; }
+
+private:
+  static constexpr size_t kClasses = 64;
+  static constexpr size_t kLocalLimit = 4;   // Per size class, per thread
+  static constexpr size_t kGlobalLimit = 64; // Per size class
+
+  // Size class `c` holds buffers of 2^c pixels
+  static size_t class_of(size_t pixels) { return std::bit_width(pixels > 1 ? pixels - 1 : 0); }
+  static size_t capacity_of(size_t size_class) { return size_t(1) << size_class; }
+
+  using Lists = std::array<std::vector<int*>, kClasses>;
+
+  struct Global {
+    std::mutex mutex;
+    Lists lists;
+
+    ~Global()
+    {
+      for (auto& list : lists)
+        for (int* buffer : list) delete[] buffer;
+    }
+  };
+
+  // When a thread exits, its free buffers go to the shared lists
+  struct Local {
+    Lists lists;
+
+    ~Local()
+    {
+      for (size_t size_class = 0; size_class < kClasses; ++size_class)
+        for (int* buffer : lists[size_class]) give_to_global(size_class, buffer);
+    }
+  };
+
+  static Global& global()
+  {
+    static Global global;
+    return global;
+  }
+
+  static Lists& local_lists()
+  {
+    // Create the shared lists first, so they outlive every thread's lists
+    static Global& shared = global();
+    (void) shared;
+    thread_local Local local;
+    return local.lists;
+  }
+
+  static void give_to_global(size_t size_class, int* buffer)
+  {
+    {
+      std::lock_guard<std::mutex> lock(global().mutex);
+      auto& shared = global().lists[size_class];
+      if (shared.size() < kGlobalLimit) {
+        shared.push_back(buffer);
+        return;
+      }
+    }
+    delete[] buffer;
+  }
+
+  static inline std::atomic<bool> is_enabled { true };
+  static inline std::atomic<size_t> hits { 0 };
+  static inline std::atomic<size_t> misses { 0 };
+};